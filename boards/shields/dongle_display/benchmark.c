@@ -0,0 +1,568 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/display.h>
+#include <zephyr/init.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <dt-bindings/zmk/keys.h>
+#include <zmk/display.h>
+#include <zmk/endpoints.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/activity_state_changed.h>
+#include <zmk/events/battery_state_changed.h>
+#include <zmk/events/keycode_state_changed.h>
+#include <zmk/events/wpm_state_changed.h>
+#include <zmk/keymap.h>
+#include <zmk/wpm.h>
+
+#include "benchmark.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_SUSPEND_ON_IDLE)
+#include "display_suspend.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_TELEMETRY)
+#include "display_telemetry.h"
+#endif
+#include "refresh_probe.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BATTERY_HISTORY)
+#include "widgets/battery_history.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_STATS)
+#include "widgets/key_stats.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER)
+#include "widgets/key_ticker.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER)
+#include "widgets/layer_status.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+#include "widgets/listener_latency.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR)
+#include "widgets/wpm_estimator.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_GRAPH)
+#include "widgets/wpm_graph.h"
+#endif
+#include "widgets/widget_listener.h"
+
+enum bench_action {
+    bench_action_settle,
+    bench_action_key_press,
+    bench_action_key_release,
+    bench_action_key_tap,
+    bench_action_layer_on,
+    bench_action_layer_off,
+    bench_action_wpm,
+    bench_action_peripheral_battery,
+    bench_action_toggle_endpoint,
+    bench_action_activity,
+    bench_action_full_refresh,
+    bench_action_transform,
+    bench_action_layer_screen,
+    bench_action_event_flood,
+};
+
+struct bench_step {
+    const char *name;
+    enum bench_action action;
+    uint32_t arg;
+    uint8_t repeat;
+};
+
+// The scripted event stream, replayed in order. The arg of a settle step is
+// how long it lasts in ms, with 0 for the regular settle time.
+static const struct bench_step script[] = {
+    {"idle", bench_action_settle},
+    {"full refresh", bench_action_full_refresh},
+    {"transform on", bench_action_transform, 1},
+    {"transform off", bench_action_transform, 0},
+    {"layer 1 on", bench_action_layer_on, 1},
+    {"layer 1 for 3s", bench_action_settle, 3000},
+    {"layer 1 off", bench_action_layer_off, 1},
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER)
+    {"name screen", bench_action_layer_screen, 1},
+    {"name layer 1 on", bench_action_layer_on, 1},
+    {"name scroll 3s", bench_action_settle, 3000},
+    {"name layer 1 off", bench_action_layer_off, 1},
+    {"status screen", bench_action_layer_screen, 0},
+#endif
+    {"shift press", bench_action_key_press, LSHIFT},
+    {"shift release", bench_action_key_release, LSHIFT},
+    {"typing burst", bench_action_key_tap, A, 20},
+#if IS_ENABLED(CONFIG_ZMK_WPM)
+    // The WPM estimator replaces ZMK's WPM and its events
+    {"wpm 20", bench_action_wpm, 20},
+    {"wpm 50", bench_action_wpm, 50},
+    {"wpm 90", bench_action_wpm, 90},
+    {"wpm 0", bench_action_wpm, 0},
+#endif
+    {"battery 80%", bench_action_peripheral_battery, 80},
+    {"battery 15%", bench_action_peripheral_battery, 15},
+    {"endpoint toggle", bench_action_toggle_endpoint},
+    {"endpoint toggle", bench_action_toggle_endpoint},
+    {"go idle", bench_action_activity, ZMK_ACTIVITY_IDLE},
+    {"idle for 5s", bench_action_settle, 5000},
+    {"go active", bench_action_activity, ZMK_ACTIVITY_ACTIVE},
+    {"1000 events/s", bench_action_event_flood, 2000},
+};
+
+static struct bench_totals {
+    atomic_t frames;
+    atomic_t render_us;
+    atomic_t flush_us;
+    atomic_t inv_px;
+    atomic_t flush_bytes;
+    atomic_t bus_bytes;
+    atomic_t layer_changes;
+    atomic_t layer_change_us;
+} step_totals, run_totals;
+
+// Written by the display thread, collected per frame by bench_frame_cb
+static atomic_t frame_bus_bytes;
+static atomic_t frame_bus_writes;
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+// Probe clock at the last layer change, until a layer widget redrew it
+static atomic_t layer_change_start;
+static atomic_t layer_change_pending;
+#endif
+
+static size_t step_index;
+static int64_t step_start;
+static uint32_t step_start_wakeups;
+static uint8_t step_repeat;
+static uint8_t run_count;
+
+static void bench_frame_cb(const struct zmk_dongle_display_frame *frame) {
+    uint32_t bus_bytes = atomic_clear(&frame_bus_bytes);
+    uint32_t bus_writes = atomic_clear(&frame_bus_writes);
+
+    LOG_INF("bench frame: %u us render, %u us flush, %u areas, %u px, %u bytes in %u flushes, "
+            "%u bus bytes in %u writes",
+            frame->render_us, frame->flush_us, frame->inv_areas, frame->inv_px, frame->flush_bytes,
+            frame->flushes, bus_bytes, bus_writes);
+
+    atomic_inc(&step_totals.frames);
+    atomic_add(&step_totals.render_us, frame->render_us);
+    atomic_add(&step_totals.flush_us, frame->flush_us);
+    atomic_add(&step_totals.inv_px, frame->inv_px);
+    atomic_add(&step_totals.flush_bytes, frame->flush_bytes);
+    atomic_add(&step_totals.bus_bytes, bus_bytes);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+// Other widgets redrawing on the same frames do not end the wait, only the
+// first flushed redraw of the roller or of the layer name screen's widget
+static void bench_drawn_cb(const char *name) {
+    if (strcmp(name, "widget_layer_roller") != 0 && strcmp(name, "widget_layer_status") != 0) {
+        return;
+    }
+
+    if (atomic_cas(&layer_change_pending, 1, 0)) {
+        uint32_t latency_us =
+            zmk_dongle_display_probe_cycles_to_ns(zmk_dongle_display_probe_cycles() -
+                                                  (uint32_t)atomic_get(&layer_change_start)) /
+            NSEC_PER_USEC;
+
+        LOG_INF("bench layer change drawn by %s after %u us", name, latency_us);
+        atomic_inc(&step_totals.layer_changes);
+        atomic_add(&step_totals.layer_change_us, latency_us);
+    }
+}
+#endif
+
+static void bench_take_totals(struct bench_totals *from, struct bench_totals *into) {
+    atomic_add(&into->frames, atomic_clear(&from->frames));
+    atomic_add(&into->render_us, atomic_clear(&from->render_us));
+    atomic_add(&into->flush_us, atomic_clear(&from->flush_us));
+    atomic_add(&into->inv_px, atomic_clear(&from->inv_px));
+    atomic_add(&into->flush_bytes, atomic_clear(&from->flush_bytes));
+    atomic_add(&into->bus_bytes, atomic_clear(&from->bus_bytes));
+    atomic_add(&into->layer_changes, atomic_clear(&from->layer_changes));
+    atomic_add(&into->layer_change_us, atomic_clear(&from->layer_change_us));
+}
+
+static void bench_log_totals(const char *name, struct bench_totals *totals) {
+    uint32_t frames = atomic_get(&totals->frames);
+    uint32_t render_us = atomic_get(&totals->render_us);
+    uint32_t flush_us = atomic_get(&totals->flush_us);
+
+    LOG_INF("bench %-16s %3u frames %7u us render %7u us flush %7u us per frame", name, frames,
+            render_us, flush_us, frames ? (render_us + flush_us) / frames : 0);
+    LOG_INF("bench %-16s %7u px %7u bytes %7u bus bytes", name,
+            (uint32_t)atomic_get(&totals->inv_px), (uint32_t)atomic_get(&totals->flush_bytes),
+            (uint32_t)atomic_get(&totals->bus_bytes));
+
+    uint32_t layer_changes = atomic_get(&totals->layer_changes);
+    if (layer_changes > 0) {
+        LOG_INF("bench %-16s %u layer changes drawn after %u us on average", name,
+                layer_changes, (uint32_t)atomic_get(&totals->layer_change_us) / layer_changes);
+    }
+}
+
+static void bench_full_refresh_work_cb(struct k_work *work) { lv_obj_invalidate(lv_scr_act()); }
+
+static K_WORK_DEFINE(bench_full_refresh_work, bench_full_refresh_work_cb);
+
+// Redraws the whole screen through LVGL's 180 degree style transform, to set
+// its render time against the configured rotation on the same build
+static bool transform_on;
+
+static void bench_transform_work_cb(struct k_work *work) {
+    lv_obj_t *screen = lv_scr_act();
+    bool on = transform_on || IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_ROTATE_180_TRANSFORM);
+
+    lv_obj_set_style_transform_angle(screen, on ? 1800 : 0, 0);
+    lv_obj_set_style_transform_pivot_x(screen, lv_pct(50), 0);
+    lv_obj_set_style_transform_pivot_y(screen, lv_pct(50), 0);
+    lv_obj_invalidate(screen);
+}
+
+static K_WORK_DEFINE(bench_transform_work, bench_transform_work_cb);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER)
+// The status screen has no layer status widget, so the layer name is drawn
+// on a screen of its own, styled like the status screen
+static struct zmk_widget_layer_status layer_status_widget;
+static lv_obj_t *layer_screen;
+static lv_obj_t *status_screen;
+static bool layer_screen_shown;
+
+static void bench_layer_screen_work_cb(struct k_work *work) {
+    if (!layer_screen_shown) {
+        if (status_screen != NULL) {
+            lv_scr_load(status_screen);
+        }
+        return;
+    }
+
+    if (layer_screen == NULL) {
+        status_screen = lv_scr_act();
+        layer_screen = lv_obj_create(NULL);
+        lv_obj_set_style_bg_color(layer_screen,
+                                  lv_obj_get_style_bg_color(status_screen, LV_PART_MAIN), 0);
+        lv_obj_set_style_bg_opa(layer_screen, LV_OPA_COVER, 0);
+        lv_obj_set_style_text_color(layer_screen,
+                                    lv_obj_get_style_text_color(status_screen, LV_PART_MAIN), 0);
+        lv_obj_set_style_text_font(layer_screen,
+                                   lv_obj_get_style_text_font(status_screen, LV_PART_MAIN), 0);
+        lv_obj_set_style_text_letter_space(
+            layer_screen, lv_obj_get_style_text_letter_space(status_screen, LV_PART_MAIN), 0);
+
+        zmk_widget_layer_status_init(&layer_status_widget, layer_screen);
+        lv_obj_align(zmk_widget_layer_status_obj(&layer_status_widget), LV_ALIGN_LEFT_MID, 0, 0);
+    }
+    lv_scr_load(layer_screen);
+}
+
+static K_WORK_DEFINE(bench_layer_screen_work, bench_layer_screen_work_cb);
+#endif
+
+// Shift presses and releases, one per ms, so the modifiers widget gets a new
+// state far more often than the display thread takes one
+static int64_t flood_start;
+static uint32_t flood_ms;
+static uint32_t flood_events;
+
+static void bench_flood_work_cb(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(bench_flood_work, bench_flood_work_cb);
+
+static void bench_flood_work_cb(struct k_work *work) {
+    uint32_t elapsed = MIN(k_uptime_get() - flood_start, flood_ms);
+
+    // Catches up on the events due while the work waited for its turn
+    for (; flood_events < elapsed; flood_events++) {
+        raise_zmk_keycode_state_changed_from_encoded(LSHIFT, flood_events % 2 == 0,
+                                                     k_uptime_get());
+        zmk_dongle_display_listener_handoff_store();
+    }
+
+    if (elapsed < flood_ms) {
+        k_work_schedule(&bench_flood_work, K_MSEC(1));
+    } else if (flood_events % 2 != 0) {
+        raise_zmk_keycode_state_changed_from_encoded(LSHIFT, false, k_uptime_get());
+    }
+}
+
+static void bench_mark_layer_change(void) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    atomic_set(&layer_change_start, zmk_dongle_display_probe_cycles());
+    atomic_set(&layer_change_pending, 1);
+#endif
+}
+
+static void bench_run_action(const struct bench_step *step) {
+    int64_t now = k_uptime_get();
+
+    switch (step->action) {
+    case bench_action_settle:
+        break;
+    case bench_action_key_press:
+        raise_zmk_keycode_state_changed_from_encoded(step->arg, true, now);
+        break;
+    case bench_action_key_release:
+        raise_zmk_keycode_state_changed_from_encoded(step->arg, false, now);
+        break;
+    case bench_action_key_tap:
+        raise_zmk_keycode_state_changed_from_encoded(step->arg, true, now);
+        raise_zmk_keycode_state_changed_from_encoded(step->arg, false, now);
+        break;
+    case bench_action_layer_on:
+        bench_mark_layer_change();
+        zmk_keymap_layer_activate(step->arg);
+        break;
+    case bench_action_layer_off:
+        bench_mark_layer_change();
+        zmk_keymap_layer_deactivate(step->arg);
+        break;
+    case bench_action_wpm:
+#if IS_ENABLED(CONFIG_ZMK_WPM)
+        raise_zmk_wpm_state_changed((struct zmk_wpm_state_changed){.state = step->arg});
+#endif
+        break;
+    case bench_action_peripheral_battery:
+        raise_zmk_peripheral_battery_state_changed(
+            (struct zmk_peripheral_battery_state_changed){.source = 0, .state_of_charge = step->arg});
+        break;
+    case bench_action_toggle_endpoint:
+        zmk_endpoints_toggle_transport();
+        break;
+    case bench_action_activity:
+        raise_zmk_activity_state_changed((struct zmk_activity_state_changed){.state = step->arg});
+        break;
+    case bench_action_full_refresh:
+        k_work_submit_to_queue(zmk_display_work_q(), &bench_full_refresh_work);
+        break;
+    case bench_action_transform:
+        transform_on = step->arg;
+        k_work_submit_to_queue(zmk_display_work_q(), &bench_transform_work);
+        break;
+    case bench_action_layer_screen:
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER)
+        layer_screen_shown = step->arg;
+        k_work_submit_to_queue(zmk_display_work_q(), &bench_layer_screen_work);
+#endif
+        break;
+    case bench_action_event_flood:
+        flood_start = now;
+        flood_ms = step->arg;
+        flood_events = 0;
+        zmk_dongle_display_listener_handoff_start();
+        k_work_schedule(&bench_flood_work, K_NO_WAIT);
+        break;
+    }
+}
+
+static uint32_t bench_wakeups(void) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_SUSPEND_ON_IDLE)
+    return zmk_dongle_display_suspend_wakeups();
+#else
+    return 0;
+#endif
+}
+
+static k_timeout_t bench_step_delay(const struct bench_step *step) {
+    if (step_repeat < MAX(step->repeat, 1)) {
+        return K_MSEC(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK_TAP_INTERVAL_MS);
+    }
+    if (step->action == bench_action_settle && step->arg > 0) {
+        return K_MSEC(step->arg);
+    }
+    if (step->action == bench_action_event_flood) {
+        return K_MSEC(step->arg + CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK_SETTLE_MS);
+    }
+    return K_MSEC(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK_SETTLE_MS);
+}
+
+static void bench_work_cb(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(bench_work, bench_work_cb);
+
+static void bench_work_cb(struct k_work *work) {
+    const struct bench_step *step = &script[step_index];
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_STATS)
+    // Timed here rather than at start, once the probe clock has calibrated
+    if (run_count == 0 && step_index == 0 && step_repeat == 0) {
+        zmk_dongle_display_key_stats_stress();
+    }
+#endif
+    if (step_repeat < MAX(step->repeat, 1)) {
+        if (step_repeat == 0) {
+            step_start = k_uptime_get();
+            step_start_wakeups = bench_wakeups();
+        }
+        bench_run_action(step);
+        step_repeat++;
+        k_work_schedule(&bench_work, bench_step_delay(step));
+        return;
+    }
+
+    // The display thread has had time to flush everything this step caused
+    bench_log_totals(step->name, &step_totals);
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_SUSPEND_ON_IDLE)
+    uint32_t step_ms = MAX(k_uptime_get() - step_start, 1);
+    uint32_t wakeups = bench_wakeups() - step_start_wakeups;
+    LOG_INF("bench %-16s %u wakeups in %u ms, %u per minute", step->name, wakeups, step_ms,
+            (uint32_t)((uint64_t)wakeups * 60000 / step_ms));
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER)
+    // Covers the scroll steps of a long layer name on the layer name screen
+    uint32_t draws, draw_us;
+    zmk_widget_layer_status_take_draw_stats(&draws, &draw_us);
+    if (draws > 0) {
+        LOG_INF("bench %-16s layer name drawn %u times, %u us per draw", step->name, draws,
+                draw_us / draws);
+    }
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR)
+#if IS_ENABLED(CONFIG_ZMK_WPM)
+    LOG_INF("bench %-16s wpm %u instant, %u smoothed, %u from zmk", step->name,
+            zmk_dongle_display_wpm_instant(), zmk_dongle_display_wpm_smoothed(),
+            zmk_wpm_get_state());
+#else
+    LOG_INF("bench %-16s wpm %u instant, %u smoothed", step->name,
+            zmk_dongle_display_wpm_instant(), zmk_dongle_display_wpm_smoothed());
+#endif
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_GRAPH)
+    uint32_t wpm_samples, wpm_sample_ns, wpm_rescales;
+    zmk_widget_wpm_graph_take_render_stats(&wpm_samples, &wpm_sample_ns, &wpm_rescales);
+    if (wpm_samples > 0) {
+        LOG_INF("bench %-16s wpm graph took %u samples, %u ns per sample, %u rescaled",
+                step->name, wpm_samples, wpm_sample_ns / wpm_samples, wpm_rescales);
+    }
+#endif
+    // The time events spent handing states to the display thread, and the
+    // reads the display thread repeated because an event stored one meanwhile
+    uint32_t stores, store_cycles, retries;
+    zmk_dongle_display_listener_take_store_stats(&stores, &store_cycles, &retries);
+    if (stores > 0) {
+        LOG_INF("bench %-16s %u states stored, %u ns per store, %u read retries", step->name,
+                stores,
+                (uint32_t)(zmk_dongle_display_probe_cycles_to_ns(store_cycles) / stores),
+                retries);
+    }
+    // Next to the stores of this build, ZMK's mutex handoff and the lock-free
+    // one under the same events, with a second thread reading
+    if (step->action == bench_action_event_flood) {
+        zmk_dongle_display_listener_handoff_stop();
+    }
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER)
+    if (zmk_widget_key_ticker_dropped() > 0) {
+        LOG_INF("bench %-16s key ticker dropped %u keys so far", step->name,
+                zmk_widget_key_ticker_dropped());
+    }
+#endif
+    bench_take_totals(&step_totals, &run_totals);
+
+    step_repeat = 0;
+    if (++step_index < ARRAY_SIZE(script)) {
+        k_work_schedule(&bench_work, K_NO_WAIT);
+        return;
+    }
+
+    bench_log_totals("run total", &run_totals);
+    zmk_dongle_display_listener_log_stats();
+    zmk_dongle_display_probe_log();
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    zmk_dongle_display_latency_log();
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_TELEMETRY)
+    zmk_dongle_display_telemetry_log();
+#endif
+    run_totals = (struct bench_totals){0};
+    step_index = 0;
+
+    if (++run_count < CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK_RUNS) {
+        k_work_schedule(&bench_work, K_MSEC(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK_SETTLE_MS));
+    } else {
+        LOG_INF("bench finished after %u runs", run_count);
+    }
+}
+
+void zmk_dongle_display_benchmark_start(void) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_ROTATE_180_FLUSH)
+    LOG_INF("bench display rotated in the flush path");
+#elif IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_ROTATE_180_TRANSFORM)
+    LOG_INF("bench display rotated by style transform");
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_FLUSH_DIFF)
+    LOG_INF("bench flushes diffed against the panel contents");
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_ASYNC_FLUSH)
+    LOG_INF("bench flushes sent asynchronously");
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BATTERY_HISTORY)
+    zmk_dongle_display_battery_history_replay();
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR)
+    zmk_dongle_display_wpm_replay();
+#endif
+    zmk_dongle_display_probe_set_frame_cb(bench_frame_cb);
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    zmk_dongle_display_latency_set_drawn_cb(bench_drawn_cb);
+#endif
+    k_work_schedule(&bench_work, K_MSEC(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK_START_DELAY_MS));
+}
+
+// An SSD1306 write sets the column and page window (6 command bytes plus
+// control bytes), then sends its data behind the address and a control byte
+#define BUS_WRITE_OVERHEAD_BYTES 10
+// Every I2C byte takes 8 data bits and an acknowledge
+#define BUS_BITS_PER_BYTE 9
+
+static void (*panel_flush_cb)(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p);
+
+static void bench_bus_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p) {
+    uint32_t bytes = (uint32_t)lv_area_get_width(area) * lv_area_get_height(area) / 8 +
+                     BUS_WRITE_OVERHEAD_BYTES;
+
+    atomic_add(&frame_bus_bytes, bytes);
+    atomic_inc(&frame_bus_writes);
+
+#if DT_HAS_COMPAT_STATUS_OKAY(zephyr_dummy_dc)
+    // The dummy display returns at once, a real bus would not. Sleeping leaves
+    // the CPU to other threads, like a DMA or interrupt driven transfer does.
+    k_usleep((uint64_t)bytes * BUS_BITS_PER_BYTE * USEC_PER_SEC /
+             CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK_BUS_HZ);
+#endif
+
+    panel_flush_cb(drv, area, color_p);
+}
+
+int zmk_dongle_display_benchmark_bus_init(void) {
+    lv_disp_t *disp = lv_disp_get_default();
+    if (disp == NULL) {
+        return -ENODEV;
+    }
+
+    panel_flush_cb = disp->driver->flush_cb;
+    disp->driver->flush_cb = bench_bus_flush_cb;
+    return 0;
+}
+
+#if DT_HAS_COMPAT_STATUS_OKAY(zephyr_dummy_dc)
+// The dummy display defaults to ARGB8888, but the shield renders 1bpp
+static int bench_display_format_init(void) {
+    const struct device *display = DEVICE_DT_GET(DT_CHOSEN(zephyr_display));
+
+    if (!device_is_ready(display)) {
+        return -ENODEV;
+    }
+
+    return display_set_pixel_format(display, PIXEL_FORMAT_MONO10);
+}
+
+SYS_INIT(bench_display_format_init, POST_KERNEL, CONFIG_APPLICATION_INIT_PRIORITY);
+#endif
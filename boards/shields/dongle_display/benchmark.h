@@ -0,0 +1,15 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+// Starts replaying the scripted event stream once the status screen is up
+void zmk_dongle_display_benchmark_start(void);
+
+// Puts a byte-counting stand-in for the panel bus behind the driver's flush,
+// which on the dummy display also takes as long as an I2C transfer would.
+// Must run before the flush stages are installed.
+int zmk_dongle_display_benchmark_bus_init(void);
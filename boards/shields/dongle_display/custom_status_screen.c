@@ -13,12 +13,35 @@
 #include "widgets/output_status.h"
 #include "widgets/hid_indicators.h"
 #include "widgets/wpm_status.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_GRAPH)
+#include "widgets/wpm_graph.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_HEATMAP)
+#include "widgets/key_heatmap.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER)
+#include "widgets/key_ticker.h"
+#endif
 #if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE)
 #include "widgets/split_battery_bar.h"
 #endif
 #if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_CAPS_WORD_INDICATOR)
 #include "widgets/caps_word_indicator.h"
 #endif
+#include "display_flush.h"
+#include "display_widgets.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_SUSPEND_ON_IDLE)
+#include "display_suspend.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_TELEMETRY)
+#include "display_telemetry.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_REFRESH_PROBE)
+#include "refresh_probe.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+#include "benchmark.h"
+#endif
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
@@ -47,14 +70,72 @@ static struct zmk_widget_modifiers modifiers_widget;
 static struct zmk_widget_wpm_status wpm_status_widget;
 #endif
 
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_GRAPH)
+static struct zmk_widget_wpm_graph wpm_graph_widget;
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER)
+static struct zmk_widget_key_ticker key_ticker_widget;
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_HEATMAP)
+static struct zmk_widget_key_heatmap key_heatmap_widget;
+#endif
+
 lv_style_t global_style;
 
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER)
+// The top row is shared with the output status, the split battery bar and the caps
+// word indicator, whose widths depend on the config; the ticker takes the gap left
+// between whatever sits there, in whole characters, and keeps the newest keys in view
+static void fit_key_ticker_to_top_row(lv_obj_t *screen, lv_obj_t *ticker) {
+    lv_obj_update_layout(screen);
+
+    lv_coord_t height = lv_obj_get_height(ticker);
+    lv_coord_t center = lv_obj_get_width(screen) / 2;
+    lv_coord_t left = 0;
+    lv_coord_t right = lv_obj_get_width(screen);
+
+    for (uint32_t i = 0; i < lv_obj_get_child_cnt(screen); i++) {
+        lv_obj_t *child = lv_obj_get_child(screen, i);
+        if (child == ticker || lv_obj_has_flag(child, LV_OBJ_FLAG_HIDDEN)) {
+            continue;
+        }
+
+        lv_area_t area;
+        lv_obj_get_coords(child, &area);
+        if (area.y1 >= height || area.y2 < 0) {
+            continue;
+        }
+
+        if ((area.x1 + area.x2) / 2 < center) {
+            left = MAX(left, area.x2 + 2);
+        } else {
+            right = MIN(right, area.x1 - 1);
+        }
+    }
+
+    lv_coord_t glyph = lv_font_get_glyph_width(&lv_font_unscii_8, 'W', 0) +
+                       lv_obj_get_style_text_letter_space(ticker, LV_PART_MAIN);
+    lv_coord_t chars = MIN((right - left) / glyph, CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER_LENGTH);
+    if (chars <= 0) {
+        LOG_WRN("No room for the key ticker in the top row");
+        lv_obj_add_flag(ticker, LV_OBJ_FLAG_HIDDEN);
+        return;
+    }
+
+    lv_obj_set_width(ticker, chars * glyph);
+    lv_obj_set_style_text_align(ticker, LV_TEXT_ALIGN_RIGHT, 0);
+    lv_obj_align(ticker, LV_ALIGN_TOP_LEFT, left + (right - left - chars * glyph) / 2, 0);
+}
+#endif
+
 lv_obj_t *zmk_display_status_screen() {
     lv_obj_t *screen;
 
     screen = lv_obj_create(NULL);
 
-#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_ROTATE_180)
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_ROTATE_180_TRANSFORM)
     // Rotate display 180 degrees
     lv_obj_set_style_transform_angle(screen, 1800, 0); // 1800 = 180 degrees (in 0.1 degree units)
     lv_obj_set_style_transform_pivot_x(screen, lv_pct(50), 0);
@@ -116,5 +197,76 @@ lv_obj_t *zmk_display_status_screen() {
     lv_obj_align(zmk_widget_wpm_status_obj(&wpm_status_widget), LV_ALIGN_BOTTOM_RIGHT, 0, 0);
 #endif
 
+    // WPM graph left of the WPM number
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_GRAPH)
+    zmk_widget_wpm_graph_init(&wpm_graph_widget, screen);
+    lv_obj_align_to(zmk_widget_wpm_graph_obj(&wpm_graph_widget),
+                    zmk_widget_wpm_status_obj(&wpm_status_widget), LV_ALIGN_OUT_LEFT_BOTTOM, -2, 0);
+#endif
+
+    // Last keys typed at the top, in the gap between the output and the batteries
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER)
+    zmk_widget_key_ticker_init(&key_ticker_widget, screen);
+    fit_key_ticker_to_top_row(screen, zmk_widget_key_ticker_obj(&key_ticker_widget));
+#endif
+
+    // Key heatmap, hidden over everything else until it is asked for
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_HEATMAP)
+    zmk_widget_key_heatmap_init(&key_heatmap_widget, screen);
+    lv_obj_align(zmk_widget_key_heatmap_obj(&key_heatmap_widget), LV_ALIGN_CENTER, 0, 0);
+#endif
+
+    // Names for the diagnostics
+    zmk_dongle_display_widget_add("layer roller",
+                                  zmk_widget_layer_roller_obj(&layer_roller_widget));
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_MODIFIERS)
+    zmk_dongle_display_widget_add("modifiers", zmk_widget_modifiers_obj(&modifiers_widget));
+#endif
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE)
+    zmk_dongle_display_widget_add("split battery",
+                                  zmk_widget_split_battery_bar_obj(&split_battery_bar_widget));
+#endif
+    zmk_dongle_display_widget_add("output status",
+                                  zmk_widget_output_status_obj(&output_status_widget));
+#if IS_ENABLED(CONFIG_ZMK_BATTERY) && IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_DONGLE_BATTERY)
+    zmk_dongle_display_widget_add(
+        "dongle battery", zmk_widget_dongle_battery_status_obj(&dongle_battery_status_widget));
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM)
+    zmk_dongle_display_widget_add("wpm", zmk_widget_wpm_status_obj(&wpm_status_widget));
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_GRAPH)
+    zmk_dongle_display_widget_add("wpm graph", zmk_widget_wpm_graph_obj(&wpm_graph_widget));
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER)
+    zmk_dongle_display_widget_add("key ticker", zmk_widget_key_ticker_obj(&key_ticker_widget));
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_KEY_HEATMAP)
+    zmk_dongle_display_widget_add("key heatmap", zmk_widget_key_heatmap_obj(&key_heatmap_widget));
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_TELEMETRY)
+    zmk_dongle_display_telemetry_init();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_SUSPEND_ON_IDLE)
+    zmk_dongle_display_suspend_init();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    zmk_dongle_display_benchmark_bus_init();
+#endif
+
+    zmk_dongle_display_flush_init();
+
+    // Installed last so it measures the flush stages too
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_REFRESH_PROBE)
+    zmk_dongle_display_probe_init();
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    zmk_dongle_display_benchmark_start();
+#endif
+
     return screen;
 }
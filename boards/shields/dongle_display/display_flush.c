@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/display.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include "display_flush.h"
+
+typedef void (*flush_cb_t)(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p);
+
+static flush_cb_t driver_flush_cb;
+
+// The stage after the rotation, working in panel coordinates
+static flush_cb_t panel_flush_cb;
+
+static inline uint8_t reverse_bits(uint8_t b) {
+    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
+    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
+    return b;
+}
+
+// Rotating a 1bpp tile by 180 degrees reverses the order of its pixels. With
+// both tilings (8 pixels per byte along x or along y) and page aligned areas,
+// that is the byte order reversed plus the bit order within every byte.
+static void rotate_180(uint8_t *buf, uint32_t len) {
+    uint8_t *head = buf;
+    uint8_t *tail = buf + len - 1;
+
+    while (head < tail) {
+        uint8_t b = reverse_bits(*head);
+        *head++ = reverse_bits(*tail);
+        *tail-- = b;
+    }
+    if (head == tail) {
+        *head = reverse_bits(*head);
+    }
+}
+
+static void rotated_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p) {
+    lv_area_t rotated = {
+        .x1 = drv->hor_res - 1 - area->x2,
+        .y1 = drv->ver_res - 1 - area->y2,
+        .x2 = drv->hor_res - 1 - area->x1,
+        .y2 = drv->ver_res - 1 - area->y1,
+    };
+
+    rotate_180((uint8_t *)color_p, (uint32_t)lv_area_get_width(area) * lv_area_get_height(area) / 8);
+
+    panel_flush_cb(drv, &rotated, color_p);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_FLUSH_DIFF)
+#define PANEL_WIDTH DT_PROP(DT_CHOSEN(zephyr_display), width)
+#define PANEL_HEIGHT DT_PROP(DT_CHOSEN(zephyr_display), height)
+
+// Every write costs the controller's column/page window commands and the I2C
+// framing on top of its data, about as much as sending this many more bytes
+#define DIFF_MERGE_GAP 8
+
+// What the panel shows, in its own layout: one byte per column and page of
+// 8 rows, as in the vtiled LVGL buffer
+static uint8_t shadow[PANEL_HEIGHT / 8][PANEL_WIDTH];
+static bool shadow_primed;
+static bool diff_wrote;
+
+static void diff_write(lv_disp_drv_t *drv, const lv_area_t *area, uint8_t *row, lv_coord_t y,
+                       lv_coord_t start, lv_coord_t end) {
+    lv_area_t run = {
+        .x1 = area->x1 + start,
+        .y1 = y,
+        .x2 = area->x1 + end,
+        .y2 = y + 7,
+    };
+
+    // One page of one column range is contiguous in the buffer already
+    driver_flush_cb(drv, &run, (lv_color_t *)(row + start));
+    diff_wrote = true;
+}
+
+// LVGL rounds vtiled areas to whole pages, so every 8 rows of the area are one
+// row of bytes, compared and stored against the shadow a page at a time
+static void diff_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p) {
+    lv_coord_t width = lv_area_get_width(area);
+    uint8_t *buf = (uint8_t *)color_p;
+
+    // The panel contents are unknown until the first full refresh went out
+    if (!shadow_primed) {
+        for (lv_coord_t y = area->y1; y <= area->y2; y += 8) {
+            memcpy(&shadow[y / 8][area->x1], buf + (y - area->y1) / 8 * width, width);
+        }
+        shadow_primed = lv_disp_flush_is_last(drv);
+        driver_flush_cb(drv, area, color_p);
+        return;
+    }
+
+    diff_wrote = false;
+
+    for (lv_coord_t y = area->y1; y <= area->y2; y += 8) {
+        uint8_t *row = buf + (y - area->y1) / 8 * width;
+        uint8_t *shadow_row = &shadow[y / 8][area->x1];
+        lv_coord_t start = -1, last = -1;
+
+        for (lv_coord_t x = 0; x < width; x++) {
+            if (row[x] == shadow_row[x]) {
+                continue;
+            }
+            if (start < 0) {
+                start = x;
+            } else if (x - last - 1 > DIFF_MERGE_GAP) {
+                diff_write(drv, area, row, y, start, last);
+                start = x;
+            }
+            last = x;
+        }
+        if (start >= 0) {
+            diff_write(drv, area, row, y, start, last);
+        }
+        memcpy(shadow_row, row, width);
+    }
+
+    // The driver signals completion of every write; without one LVGL still waits
+    if (!diff_wrote) {
+        lv_disp_flush_ready(drv);
+    }
+}
+
+static int diff_init(lv_disp_t *disp) {
+    const struct device *display = DEVICE_DT_GET(DT_CHOSEN(zephyr_display));
+    struct display_capabilities caps;
+
+    display_get_capabilities(display, &caps);
+    if (!(caps.screen_info & SCREEN_INFO_MONO_VTILED) || disp->driver->hor_res != PANEL_WIDTH ||
+        disp->driver->ver_res != PANEL_HEIGHT) {
+        LOG_ERR("Flush diffing needs a vtiled %dx%d panel", PANEL_WIDTH, PANEL_HEIGHT);
+        return -ENOTSUP;
+    }
+
+    panel_flush_cb = diff_flush_cb;
+    return 0;
+}
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_ASYNC_FLUSH)
+// The stages and the driver run on the transfer thread and signal completion
+// of every write they make on this private copy of the driver, so LVGL only
+// learns that its buffer is free once the whole chunk went out
+static lv_disp_drv_t transfer_drv;
+static lv_disp_draw_buf_t transfer_draw_buf;
+static flush_cb_t stages_flush_cb;
+
+static lv_disp_drv_t *pending_drv;
+static lv_area_t pending_area;
+static lv_color_t *pending_color_p;
+
+static K_SEM_DEFINE(transfer_start, 0, 1);
+static K_SEM_DEFINE(transfer_done, 0, 1);
+
+static void transfer_thread_main(void *p1, void *p2, void *p3) {
+    while (true) {
+        k_sem_take(&transfer_start, K_FOREVER);
+
+        stages_flush_cb(&transfer_drv, &pending_area, pending_color_p);
+
+        lv_disp_flush_ready(pending_drv);
+        k_sem_give(&transfer_done);
+    }
+}
+
+K_THREAD_DEFINE(dongle_display_transfer, CONFIG_ZMK_DONGLE_DISPLAY_ASYNC_FLUSH_STACK_SIZE,
+                transfer_thread_main, NULL, NULL, NULL,
+                CONFIG_ZMK_DONGLE_DISPLAY_ASYNC_FLUSH_PRIORITY, 0, 0);
+
+// Returns at once, so LVGL renders the next chunk into its other buffer
+// while this one is being sent
+static void async_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p) {
+    // LVGL does not flush again before the last transfer signalled
+    // completion, so one pending transfer is all there can be. The area is
+    // copied, as LVGL passes one from its stack.
+    pending_drv = drv;
+    pending_area = *area;
+    pending_color_p = color_p;
+
+    transfer_draw_buf.flushing = 1;
+    transfer_draw_buf.flushing_last = drv->draw_buf->flushing_last;
+
+    k_sem_give(&transfer_start);
+}
+
+// LVGL calls this in a loop while the buffer it needs next is still being sent
+static void async_wait_cb(lv_disp_drv_t *drv) { k_sem_take(&transfer_done, K_MSEC(100)); }
+
+static int async_init(lv_disp_t *disp) {
+    if (disp->driver->draw_buf->buf2 == NULL) {
+        LOG_ERR("Asynchronous flushing needs two render buffers (CONFIG_LV_Z_DOUBLE_VDB)");
+        return -ENOTSUP;
+    }
+
+    stages_flush_cb = disp->driver->flush_cb;
+    transfer_drv = *disp->driver;
+    transfer_drv.draw_buf = &transfer_draw_buf;
+
+    disp->driver->flush_cb = async_flush_cb;
+    disp->driver->wait_cb = async_wait_cb;
+    return 0;
+}
+#endif
+
+int zmk_dongle_display_flush_init(void) {
+    lv_disp_t *disp = lv_disp_get_default();
+    if (disp == NULL) {
+        LOG_ERR("No LVGL display to flush to");
+        return -ENODEV;
+    }
+
+    if (driver_flush_cb != NULL) {
+        return 0;
+    }
+    driver_flush_cb = disp->driver->flush_cb;
+    panel_flush_cb = driver_flush_cb;
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_FLUSH_DIFF)
+    if (diff_init(disp) == 0) {
+        disp->driver->flush_cb = panel_flush_cb;
+    }
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_ROTATE_180_FLUSH)
+    // Mirrored areas stay page aligned only if the panel is made of whole pages
+    if (disp->driver->hor_res % 8 != 0 || disp->driver->ver_res % 8 != 0) {
+        LOG_ERR("Cannot rotate a %dx%d panel in the flush path", disp->driver->hor_res,
+                disp->driver->ver_res);
+        return -ENOTSUP;
+    }
+    disp->driver->flush_cb = rotated_flush_cb;
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_ASYNC_FLUSH)
+    // Last, so every other stage runs on the transfer thread
+    async_init(disp);
+#endif
+
+    return 0;
+}
@@ -0,0 +1,14 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+
+// Installs the shield's flush stages in front of the display driver's flush.
+// Must run on the display thread after the display has been registered.
+int zmk_dongle_display_flush_init(void);
@@ -0,0 +1,11 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/shell/shell.h>
+
+// Diagnostics of the modules add their subcommands with SHELL_SUBCMD_ADD
+SHELL_SUBCMD_SET_CREATE(sub_dongle_display, (dongle_display));
+SHELL_CMD_REGISTER(dongle_display, &sub_dongle_display, "Dongle display diagnostics", NULL);
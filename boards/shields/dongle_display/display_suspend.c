@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/display.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/display.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/activity_state_changed.h>
+
+#include "display_suspend.h"
+
+#define SUSPEND_MAX_TIMERS 16
+
+// Timers this module paused, so timers paused by their owners stay paused
+static lv_timer_t *paused_timers[SUSPEND_MAX_TIMERS];
+static size_t paused_count;
+static bool suspended;
+
+static lv_timer_t *wakeup_timer;
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_REFRESH_PROBE)
+static atomic_t wakeups;
+
+// With a period of 0 this runs on every lv_timer_handler call
+static void wakeup_timer_cb(lv_timer_t *timer) { atomic_inc(&wakeups); }
+
+uint32_t zmk_dongle_display_suspend_wakeups(void) { return atomic_get(&wakeups); }
+#endif
+
+static bool paused_by_suspend(const lv_timer_t *timer) {
+    for (size_t i = 0; i < paused_count; i++) {
+        if (paused_timers[i] == timer) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Pausing every timer covers the refresh timer, the widget listeners and the
+// animation timer that drives the bongo cat and scrolling labels
+static void suspend_work_cb(struct k_work *work) {
+    if (suspended) {
+        return;
+    }
+
+    for (lv_timer_t *timer = lv_timer_get_next(NULL); timer != NULL;
+         timer = lv_timer_get_next(timer)) {
+        if (timer->paused || timer == wakeup_timer) {
+            continue;
+        }
+        if (paused_count == ARRAY_SIZE(paused_timers)) {
+            LOG_WRN("Too many LVGL timers, some keep running while idle");
+            break;
+        }
+        lv_timer_pause(timer);
+        paused_timers[paused_count++] = timer;
+    }
+    suspended = true;
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_SUSPEND_FREEZE)
+    // ZMK's blanking work for the same event ran before this one and stopped
+    // the tick along with the panel; show the last frame again
+    display_blanking_off(DEVICE_DT_GET(DT_CHOSEN(zephyr_display)));
+#endif
+}
+
+static void resume_work_cb(struct k_work *work) {
+    if (!suspended) {
+        return;
+    }
+
+    // Timers deleted meanwhile are no longer in the list and are skipped
+    for (lv_timer_t *timer = lv_timer_get_next(NULL); timer != NULL;
+         timer = lv_timer_get_next(timer)) {
+        if (paused_by_suspend(timer)) {
+            lv_timer_resume(timer);
+        }
+    }
+    paused_count = 0;
+    suspended = false;
+
+    // Updates that arrived while suspended were never drawn
+    lv_obj_invalidate(lv_scr_act());
+}
+
+static K_WORK_DEFINE(suspend_work, suspend_work_cb);
+static K_WORK_DEFINE(resume_work, resume_work_cb);
+
+static int display_suspend_listener(const zmk_event_t *eh) {
+    struct zmk_activity_state_changed *ev = as_zmk_activity_state_changed(eh);
+    if (ev == NULL || !zmk_display_is_initialized()) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    switch (ev->state) {
+    case ZMK_ACTIVITY_ACTIVE:
+        k_work_cancel(&suspend_work);
+        k_work_submit_to_queue(zmk_display_work_q(), &resume_work);
+        return ZMK_EV_EVENT_BUBBLE;
+    case ZMK_ACTIVITY_IDLE:
+    case ZMK_ACTIVITY_SLEEP:
+        break;
+    default:
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    // Hands the event to the listeners after this one before the suspend is
+    // queued. Whatever the listener order, ZMK has then queued its blanking
+    // work on the display queue, which runs it first. The event is freed by
+    // the release, so it is captured here.
+    zmk_event_manager_release((zmk_event_t *)eh);
+    k_work_submit_to_queue(zmk_display_work_q(), &suspend_work);
+    return ZMK_EV_EVENT_CAPTURED;
+}
+
+ZMK_LISTENER(dongle_display_suspend, display_suspend_listener);
+ZMK_SUBSCRIPTION(dongle_display_suspend, zmk_activity_state_changed);
+
+int zmk_dongle_display_suspend_init(void) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_REFRESH_PROBE)
+    if (wakeup_timer == NULL) {
+        wakeup_timer = lv_timer_create(wakeup_timer_cb, 0, NULL);
+    }
+#endif
+    return 0;
+}
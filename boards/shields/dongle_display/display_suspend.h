@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/kernel.h>
+
+// Starts counting display thread wakeups when the refresh probe is enabled.
+// Must run on the display thread.
+int zmk_dongle_display_suspend_init(void);
+
+// lv_timer_handler runs since boot, one per wakeup of the display thread
+uint32_t zmk_dongle_display_suspend_wakeups(void);
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/sys_heap.h>
+#include <zephyr/sys/util.h>
+#include <lvgl_mem.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/display.h>
+
+#include "display_telemetry.h"
+#include "display_widgets.h"
+
+#if IS_ENABLED(CONFIG_ZMK_DISPLAY_WORK_QUEUE_DEDICATED)
+#define DISPLAY_STACK_SIZE CONFIG_ZMK_DISPLAY_DEDICATED_THREAD_STACK_SIZE
+#define DISPLAY_STACK_OPTION "CONFIG_ZMK_DISPLAY_DEDICATED_THREAD_STACK_SIZE"
+#else
+#define DISPLAY_STACK_SIZE CONFIG_SYSTEM_WORKQUEUE_STACK_SIZE
+#define DISPLAY_STACK_OPTION "CONFIG_SYSTEM_WORKQUEUE_STACK_SIZE"
+#endif
+
+static struct telemetry_snapshot {
+    uint32_t heap_used;
+    uint32_t heap_free;
+    uint32_t heap_largest_free;
+    uint32_t heap_high_water;
+    uint32_t stack_used;
+    uint16_t objs[ZMK_DONGLE_DISPLAY_MAX_WIDGETS];
+    uint16_t objs_total;
+} snapshot;
+
+// The heap behind lvgl_malloc, found once, NULL if it is not among the saved heaps
+static struct sys_heap *lvgl_heap;
+static bool lvgl_heap_searched;
+
+// lvgl_mem.c keeps its heap to itself, so it is the saved heap of the pool's
+// size whose statistics match what lvgl_heap_stats() reports
+static struct sys_heap *find_lvgl_heap(void) {
+#if CONFIG_SYS_HEAP_ARRAY_SIZE > 0
+    struct sys_heap **heaps;
+    struct sys_memory_stats lvgl_stats, stats;
+    int count = sys_heap_array_get(&heaps);
+
+    lvgl_heap_stats(&lvgl_stats);
+    for (int i = 0; i < count; i++) {
+        if (heaps[i]->init_bytes == CONFIG_LV_Z_MEM_POOL_SIZE &&
+            sys_heap_runtime_stats_get(heaps[i], &stats) == 0 &&
+            stats.allocated_bytes == lvgl_stats.allocated_bytes &&
+            stats.free_bytes == lvgl_stats.free_bytes) {
+            return heaps[i];
+        }
+    }
+#endif
+    return NULL;
+}
+
+static uint16_t count_objs(const lv_obj_t *obj) {
+    uint16_t count = 1;
+    for (uint32_t i = 0; i < lv_obj_get_child_cnt(obj); i++) {
+        count += count_objs(lv_obj_get_child(obj, i));
+    }
+    return count;
+}
+
+// Binary search for the biggest block the heap can still hand out
+static size_t heap_largest_free(size_t free_bytes) {
+    size_t low = 0, high = free_bytes;
+
+    while (low < high) {
+        size_t mid = low + (high - low + 1) / 2;
+        void *block = lvgl_malloc(mid);
+
+        if (block != NULL) {
+            lvgl_free(block);
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+// Runs on the display thread, so LVGL and its heap are not in use meanwhile
+static void take_snapshot(void) {
+    struct sys_memory_stats stats;
+    lvgl_heap_stats(&stats);
+
+    snapshot.heap_used = stats.allocated_bytes;
+    snapshot.heap_free = stats.free_bytes;
+
+    // The heap's maximum is reset after every probe below, so it holds the
+    // peak since the last report
+    snapshot.heap_high_water = MAX(snapshot.heap_high_water, (uint32_t)stats.max_allocated_bytes);
+
+    if (!lvgl_heap_searched) {
+        lvgl_heap = find_lvgl_heap();
+        lvgl_heap_searched = true;
+        if (lvgl_heap == NULL) {
+            LOG_WRN("LVGL heap not found, set CONFIG_SYS_HEAP_ARRAY_SIZE to report fragmentation");
+        }
+    }
+
+    // Probing for the largest block raises the maximum to nearly the whole
+    // heap, which would hide every later peak unless it can be reset
+    if (lvgl_heap != NULL) {
+        snapshot.heap_largest_free = heap_largest_free(stats.free_bytes);
+        sys_heap_runtime_stats_reset_max(lvgl_heap);
+    } else {
+        snapshot.heap_largest_free = stats.free_bytes;
+    }
+
+    size_t unused = 0;
+    k_thread_stack_space_get(k_work_queue_thread_get(zmk_display_work_q()), &unused);
+    snapshot.stack_used = DISPLAY_STACK_SIZE - unused;
+
+    snapshot.objs_total = count_objs(lv_scr_act());
+    for (size_t i = 0; i < zmk_dongle_display_widget_count(); i++) {
+        snapshot.objs[i] = count_objs(zmk_dongle_display_widget_get(i)->obj);
+    }
+}
+
+static uint8_t heap_frag_pct(void) {
+    if (snapshot.heap_free == 0) {
+        return 0;
+    }
+    return 100 - (snapshot.heap_largest_free * 100) / snapshot.heap_free;
+}
+
+static uint32_t recommended_pool_size(void) {
+    return ROUND_UP(snapshot.heap_high_water * 5 / 4, 1024);
+}
+
+static uint32_t recommended_stack_size(void) {
+    return ROUND_UP(snapshot.stack_used * 5 / 4, 256);
+}
+
+static void telemetry_log_work_cb(struct k_work *work) {
+    take_snapshot();
+
+    LOG_INF("LVGL heap: %u used, %u free, %u%% fragmented, %u high-water", snapshot.heap_used,
+            snapshot.heap_free, heap_frag_pct(), snapshot.heap_high_water);
+    LOG_INF("Display stack: %u of %u used", snapshot.stack_used, DISPLAY_STACK_SIZE);
+    LOG_INF("LVGL objects: %u on screen", snapshot.objs_total);
+    for (size_t i = 0; i < zmk_dongle_display_widget_count(); i++) {
+        LOG_INF("  %s: %u", zmk_dongle_display_widget_get(i)->name, snapshot.objs[i]);
+    }
+    LOG_INF("Recommended: CONFIG_LV_Z_MEM_POOL_SIZE=%u", recommended_pool_size());
+    LOG_INF("Recommended: " DISPLAY_STACK_OPTION "=%u", recommended_stack_size());
+}
+
+static K_WORK_DEFINE(telemetry_log_work, telemetry_log_work_cb);
+
+void zmk_dongle_display_telemetry_log(void) {
+    k_work_submit_to_queue(zmk_display_work_q(), &telemetry_log_work);
+}
+
+#if CONFIG_ZMK_DONGLE_DISPLAY_TELEMETRY_LOG_INTERVAL_S > 0
+static void telemetry_periodic_work_cb(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(telemetry_periodic_work, telemetry_periodic_work_cb);
+
+static void telemetry_periodic_work_cb(struct k_work *work) {
+    telemetry_log_work_cb(work);
+    k_work_schedule_for_queue(zmk_display_work_q(), &telemetry_periodic_work,
+                              K_SECONDS(CONFIG_ZMK_DONGLE_DISPLAY_TELEMETRY_LOG_INTERVAL_S));
+}
+#endif
+
+void zmk_dongle_display_telemetry_init(void) {
+#if CONFIG_ZMK_DONGLE_DISPLAY_TELEMETRY_LOG_INTERVAL_S > 0
+    k_work_schedule_for_queue(zmk_display_work_q(), &telemetry_periodic_work,
+                              K_SECONDS(CONFIG_ZMK_DONGLE_DISPLAY_TELEMETRY_LOG_INTERVAL_S));
+#endif
+}
+
+#if IS_ENABLED(CONFIG_SHELL)
+static K_SEM_DEFINE(telemetry_shell_sem, 0, 1);
+
+static void telemetry_shell_work_cb(struct k_work *work) {
+    take_snapshot();
+    k_sem_give(&telemetry_shell_sem);
+}
+
+static K_WORK_DEFINE(telemetry_shell_work, telemetry_shell_work_cb);
+
+static int cmd_telemetry(const struct shell *sh, size_t argc, char **argv) {
+    k_sem_reset(&telemetry_shell_sem);
+    k_work_submit_to_queue(zmk_display_work_q(), &telemetry_shell_work);
+    if (k_sem_take(&telemetry_shell_sem, K_SECONDS(1)) != 0) {
+        shell_error(sh, "Display thread did not respond");
+        return -ETIMEDOUT;
+    }
+
+    shell_print(sh, "LVGL heap:     %u used, %u free, %u%% fragmented", snapshot.heap_used,
+                snapshot.heap_free, heap_frag_pct());
+    shell_print(sh, "  high-water:  %u", snapshot.heap_high_water);
+    shell_print(sh, "Display stack: %u of %u used", snapshot.stack_used, DISPLAY_STACK_SIZE);
+    shell_print(sh, "LVGL objects:  %u on screen", snapshot.objs_total);
+    for (size_t i = 0; i < zmk_dongle_display_widget_count(); i++) {
+        shell_print(sh, "  %-14s %u", zmk_dongle_display_widget_get(i)->name, snapshot.objs[i]);
+    }
+    shell_print(sh, "Recommended:   CONFIG_LV_Z_MEM_POOL_SIZE=%u", recommended_pool_size());
+    shell_print(sh, "               " DISPLAY_STACK_OPTION "=%u", recommended_stack_size());
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((dongle_display), telemetry, NULL, "LVGL heap, object and stack usage",
+                 cmd_telemetry, 1, 0);
+#endif
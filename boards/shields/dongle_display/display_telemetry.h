@@ -0,0 +1,16 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+
+// Starts the periodic log, if configured. Must run once the screen is built.
+void zmk_dongle_display_telemetry_init(void);
+
+// Logs heap, object count and stack usage from the display thread
+void zmk_dongle_display_telemetry_log(void);
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <zephyr/kernel.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include "display_widgets.h"
+
+static struct zmk_dongle_display_widget widgets[ZMK_DONGLE_DISPLAY_MAX_WIDGETS];
+static size_t widget_count;
+
+void zmk_dongle_display_widget_add(const char *name, lv_obj_t *obj) {
+    if (widget_count >= ARRAY_SIZE(widgets)) {
+        LOG_WRN("Too many widgets, %s is left out of the diagnostics", name);
+        return;
+    }
+    widgets[widget_count++] = (struct zmk_dongle_display_widget){
+        .name = name,
+        .obj = obj,
+    };
+}
+
+size_t zmk_dongle_display_widget_count(void) { return widget_count; }
+
+const struct zmk_dongle_display_widget *zmk_dongle_display_widget_get(size_t index) {
+    return &widgets[index];
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+
+#define ZMK_DONGLE_DISPLAY_MAX_WIDGETS 12
+
+// Top-level object of a widget on the status screen, for diagnostics
+struct zmk_dongle_display_widget {
+    const char *name;
+    lv_obj_t *obj;
+};
+
+void zmk_dongle_display_widget_add(const char *name, lv_obj_t *obj);
+size_t zmk_dongle_display_widget_count(void);
+const struct zmk_dongle_display_widget *zmk_dongle_display_widget_get(size_t index);
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include "display_widgets.h"
+#include "refresh_probe.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+#include "widgets/listener_latency.h"
+#endif
+
+// Power-of-two buckets; the last one takes everything from 2^14 up
+#define PROBE_HIST_BUCKETS 16
+
+// One entry of the frame history, narrowed to keep the ring small
+struct probe_record {
+    uint32_t render_us;
+    uint32_t flush_us;
+    uint16_t inv_px;
+    uint16_t flush_bytes;
+    uint8_t inv_areas;
+    uint8_t flushes;
+};
+
+struct probe_hist {
+    uint16_t buckets[PROBE_HIST_BUCKETS];
+    uint32_t sum;
+    uint32_t max;
+};
+
+// Summary of the frame history, built on the display thread
+static struct probe_report {
+    uint16_t frames;
+    struct probe_hist render_us;
+    struct probe_hist flush_us;
+    struct probe_hist inv_areas;
+    struct probe_hist inv_px;
+    struct probe_hist flush_bytes;
+    uint32_t widget_px[ZMK_DONGLE_DISPLAY_MAX_WIDGETS];
+    uint32_t other_px;
+} report;
+
+static lv_disp_t *probed_disp;
+static void (*driver_flush_cb)(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p);
+static void (*driver_monitor_cb)(lv_disp_drv_t *drv, uint32_t time, uint32_t px);
+static void (*driver_wait_cb)(lv_disp_drv_t *drv);
+static zmk_dongle_display_frame_cb_t frame_cb;
+
+static struct zmk_dongle_display_frame current_frame;
+
+static struct probe_record history[CONFIG_ZMK_DONGLE_DISPLAY_REFRESH_PROBE_HISTORY];
+static uint32_t history_count;
+
+// Invalidated pixels per widget since the last report
+static uint32_t widget_px[ZMK_DONGLE_DISPLAY_MAX_WIDGETS];
+static uint32_t other_px;
+
+#if IS_ENABLED(CONFIG_ARCH_POSIX) && (defined(__i386__) || defined(__x86_64__))
+// native_sim keeps its uptime in step with the host's wall clock by default,
+// which calibrates the host counter
+static uint64_t host_start_tsc;
+static int64_t host_start_ticks;
+
+static void probe_clock_init(void) {
+    host_start_tsc = __builtin_ia32_rdtsc();
+    host_start_ticks = k_uptime_ticks();
+}
+
+uint32_t zmk_dongle_display_probe_cycles(void) { return (uint32_t)__builtin_ia32_rdtsc(); }
+
+uint64_t zmk_dongle_display_probe_cycles_to_ns(uint64_t cycles) {
+    uint64_t tsc = __builtin_ia32_rdtsc() - host_start_tsc;
+    uint64_t ns = k_ticks_to_ns_floor64(k_uptime_ticks() - host_start_ticks);
+
+    // Nanoseconds per host cycle in 16.16 fixed point, so neither product overflows
+    return tsc ? cycles * ((ns << 16) / tsc) >> 16 : 0;
+}
+#else
+static void probe_clock_init(void) {}
+
+uint32_t zmk_dongle_display_probe_cycles(void) { return k_cycle_get_32(); }
+
+uint64_t zmk_dongle_display_probe_cycles_to_ns(uint64_t cycles) {
+    return k_cyc_to_ns_floor64(cycles);
+}
+#endif
+
+static uint32_t probe_elapsed_us(uint32_t start) {
+    return zmk_dongle_display_probe_cycles_to_ns(zmk_dongle_display_probe_cycles() - start) /
+           NSEC_PER_USEC;
+}
+
+static uint32_t area_bytes(const lv_area_t *area) {
+    return (uint32_t)lv_area_get_width(area) * lv_area_get_height(area) * LV_COLOR_DEPTH / 8;
+}
+
+static void probe_flush_cb(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_p) {
+    current_frame.flushes++;
+    current_frame.flush_bytes += area_bytes(area);
+
+    uint32_t start = zmk_dongle_display_probe_cycles();
+    driver_flush_cb(drv, area, color_p);
+    current_frame.flush_us += probe_elapsed_us(start);
+}
+
+// With asynchronous flushing the display thread waits here for the transfer
+static void probe_wait_cb(lv_disp_drv_t *drv) {
+    uint32_t start = zmk_dongle_display_probe_cycles();
+    driver_wait_cb(drv);
+    current_frame.flush_us += probe_elapsed_us(start);
+}
+
+static void probe_monitor_cb(lv_disp_drv_t *drv, uint32_t time, uint32_t px) {
+    current_frame.inv_px = px;
+
+    if (driver_monitor_cb != NULL) {
+        driver_monitor_cb(drv, time, px);
+    }
+}
+
+// Charges an invalidated area to every widget it overlaps
+static void attribute_area(const lv_area_t *area) {
+    bool attributed = false;
+
+    for (size_t i = 0; i < zmk_dongle_display_widget_count(); i++) {
+        lv_area_t coords, common;
+
+        lv_obj_get_coords(zmk_dongle_display_widget_get(i)->obj, &coords);
+        if (_lv_area_intersect(&common, area, &coords)) {
+            widget_px[i] += lv_area_get_size(&common);
+            attributed = true;
+        }
+    }
+
+    if (!attributed) {
+        other_px += lv_area_get_size(area);
+    }
+}
+
+static void record_frame(const struct zmk_dongle_display_frame *frame) {
+    history[history_count++ % ARRAY_SIZE(history)] = (struct probe_record){
+        .render_us = frame->render_us,
+        .flush_us = frame->flush_us,
+        .inv_px = MIN(frame->inv_px, UINT16_MAX),
+        .flush_bytes = MIN(frame->flush_bytes, UINT16_MAX),
+        .inv_areas = MIN(frame->inv_areas, UINT8_MAX),
+        .flushes = MIN(frame->flushes, UINT8_MAX),
+    };
+}
+
+static void probe_refr_timer_cb(lv_timer_t *timer) {
+    current_frame = (struct zmk_dongle_display_frame){0};
+
+    // Joining happens inside the refresh, so this is what the widgets asked for
+    for (uint16_t i = 0; i < probed_disp->inv_p; i++) {
+        if (!probed_disp->inv_area_joined[i]) {
+            current_frame.inv_areas++;
+            attribute_area(&probed_disp->inv_areas[i]);
+        }
+    }
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    zmk_dongle_display_latency_refresh_begin(probed_disp);
+#endif
+
+    uint32_t start = zmk_dongle_display_probe_cycles();
+    _lv_disp_refr_timer(timer);
+    uint32_t refresh_us = probe_elapsed_us(start);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    // With asynchronous flushing the refresh returns while the last chunk is
+    // still being sent. The pixels are only on the panel once it went out, so
+    // this waits for it too, outside the frame's flush time.
+    lv_disp_drv_t *drv = probed_disp->driver;
+    while (drv->draw_buf->flushing) {
+        if (driver_wait_cb != NULL) {
+            driver_wait_cb(drv);
+        }
+    }
+    zmk_dongle_display_latency_refresh_end(current_frame.flushes > 0);
+#endif
+
+    if (current_frame.flushes == 0) {
+        return;
+    }
+
+    current_frame.render_us = refresh_us - MIN(refresh_us, current_frame.flush_us);
+    record_frame(&current_frame);
+
+    if (frame_cb != NULL) {
+        frame_cb(&current_frame);
+    }
+}
+
+static uint8_t hist_bucket(uint32_t value) {
+    if (value == 0) {
+        return 0;
+    }
+    return MIN(32 - __builtin_clz(value), PROBE_HIST_BUCKETS - 1);
+}
+
+static void hist_add(struct probe_hist *hist, uint32_t value) {
+    hist->buckets[hist_bucket(value)]++;
+    hist->sum += value;
+    hist->max = MAX(hist->max, value);
+}
+
+// Runs on the display thread, so the history is not written meanwhile
+static void build_report(void) {
+    report = (struct probe_report){0};
+    report.frames = MIN(history_count, ARRAY_SIZE(history));
+
+    for (size_t i = 0; i < report.frames; i++) {
+        const struct probe_record *record = &history[i];
+
+        hist_add(&report.render_us, record->render_us);
+        hist_add(&report.flush_us, record->flush_us);
+        hist_add(&report.inv_areas, record->inv_areas);
+        hist_add(&report.inv_px, record->inv_px);
+        hist_add(&report.flush_bytes, record->flush_bytes);
+    }
+
+    memcpy(report.widget_px, widget_px, sizeof(widget_px));
+    report.other_px = other_px;
+    memset(widget_px, 0, sizeof(widget_px));
+    other_px = 0;
+}
+
+// Formats one histogram as "name avg/max | bucket:count ..." for non-empty buckets
+static void format_hist(char *buf, size_t len, const char *name, const struct probe_hist *hist) {
+    int pos = snprintf(buf, len, "%-12s avg %6u max %6u |", name,
+                       report.frames ? hist->sum / report.frames : 0, hist->max);
+
+    for (int i = 0; i < PROBE_HIST_BUCKETS && pos > 0 && pos < len; i++) {
+        if (hist->buckets[i] == 0) {
+            continue;
+        }
+        pos += snprintf(buf + pos, len - pos, " %u+:%u", i ? 1U << (i - 1) : 0, hist->buckets[i]);
+    }
+}
+
+#define REPORT_HISTS(X)                                                                            \
+    X("render us", render_us)                                                                      \
+    X("flush us", flush_us)                                                                        \
+    X("inv areas", inv_areas)                                                                      \
+    X("inv px", inv_px)                                                                            \
+    X("flush bytes", flush_bytes)
+
+static void probe_log_work_cb(struct k_work *work) {
+    char line[160];
+
+    build_report();
+
+    LOG_INF("Last %u refreshes:", report.frames);
+#define LOG_HIST(name, field)                                                                      \
+    format_hist(line, sizeof(line), name, &report.field);                                          \
+    LOG_INF("%s", line);
+    REPORT_HISTS(LOG_HIST)
+#undef LOG_HIST
+
+    LOG_INF("Invalidated px since the last report:");
+    for (size_t i = 0; i < zmk_dongle_display_widget_count(); i++) {
+        LOG_INF("  %s: %u", zmk_dongle_display_widget_get(i)->name, report.widget_px[i]);
+    }
+    LOG_INF("  other: %u", report.other_px);
+}
+
+static K_WORK_DEFINE(probe_log_work, probe_log_work_cb);
+
+void zmk_dongle_display_probe_log(void) {
+    k_work_submit_to_queue(zmk_display_work_q(), &probe_log_work);
+}
+
+void zmk_dongle_display_probe_set_frame_cb(zmk_dongle_display_frame_cb_t cb) { frame_cb = cb; }
+
+int zmk_dongle_display_probe_init(void) {
+    lv_disp_t *disp = lv_disp_get_default();
+    if (disp == NULL || disp->refr_timer == NULL) {
+        LOG_ERR("No LVGL display to probe");
+        return -ENODEV;
+    }
+
+    if (probed_disp != NULL) {
+        return 0;
+    }
+    probed_disp = disp;
+    probe_clock_init();
+
+    driver_flush_cb = disp->driver->flush_cb;
+    disp->driver->flush_cb = probe_flush_cb;
+
+    driver_monitor_cb = disp->driver->monitor_cb;
+    disp->driver->monitor_cb = probe_monitor_cb;
+
+    driver_wait_cb = disp->driver->wait_cb;
+    if (driver_wait_cb != NULL) {
+        disp->driver->wait_cb = probe_wait_cb;
+    }
+
+    lv_timer_set_cb(disp->refr_timer, probe_refr_timer_cb);
+
+    return 0;
+}
+
+#if IS_ENABLED(CONFIG_SHELL)
+static K_SEM_DEFINE(probe_shell_sem, 0, 1);
+
+static void probe_shell_work_cb(struct k_work *work) {
+    build_report();
+    k_sem_give(&probe_shell_sem);
+}
+
+static K_WORK_DEFINE(probe_shell_work, probe_shell_work_cb);
+
+static int cmd_refresh(const struct shell *sh, size_t argc, char **argv) {
+    char line[160];
+
+    k_sem_reset(&probe_shell_sem);
+    k_work_submit_to_queue(zmk_display_work_q(), &probe_shell_work);
+    if (k_sem_take(&probe_shell_sem, K_SECONDS(1)) != 0) {
+        shell_error(sh, "Display thread did not respond");
+        return -ETIMEDOUT;
+    }
+
+    shell_print(sh, "Last %u refreshes:", report.frames);
+#define PRINT_HIST(name, field)                                                                    \
+    format_hist(line, sizeof(line), name, &report.field);                                          \
+    shell_print(sh, "%s", line);
+    REPORT_HISTS(PRINT_HIST)
+#undef PRINT_HIST
+
+    shell_print(sh, "Invalidated px since the last report:");
+    for (size_t i = 0; i < zmk_dongle_display_widget_count(); i++) {
+        shell_print(sh, "  %-14s %u", zmk_dongle_display_widget_get(i)->name,
+                    report.widget_px[i]);
+    }
+    shell_print(sh, "  %-14s %u", "other", report.other_px);
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((dongle_display), refresh, NULL, "Display refresh cost histograms", cmd_refresh,
+                 1, 0);
+#endif
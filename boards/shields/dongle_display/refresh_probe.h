@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+
+// Cost of one LVGL refresh of the default display
+struct zmk_dongle_display_frame {
+    uint32_t render_us;   // refresh time outside the flush callback
+    uint32_t flush_us;    // time spent in the flush callback or waiting for it
+    uint32_t inv_px;      // invalidated pixels after LVGL joined the areas
+    uint32_t flush_bytes; // bytes handed to the display driver
+    uint16_t inv_areas;   // invalidated rectangles before joining
+    uint16_t flushes;     // flush_cb calls
+};
+
+// Timestamp in cycles for measuring how long code runs. The kernel clock of
+// native_sim stands still while code runs, so there it counts the host's time
+// stamp counter instead, calibrated against the uptime since probe init.
+uint32_t zmk_dongle_display_probe_cycles(void);
+uint64_t zmk_dongle_display_probe_cycles_to_ns(uint64_t cycles);
+
+typedef void (*zmk_dongle_display_frame_cb_t)(const struct zmk_dongle_display_frame *frame);
+
+// Hooks the refresh timer and flush callback of the default display.
+// Must run on the display thread after the display has been registered.
+int zmk_dongle_display_probe_init(void);
+
+// Called on the display thread after every refresh that drew something
+void zmk_dongle_display_probe_set_frame_cb(zmk_dongle_display_frame_cb_t cb);
+
+// Logs histograms of the recent frames and the area each widget invalidated
+void zmk_dongle_display_probe_log(void);
@@ -0,0 +1,262 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 The ZMK Contributors
+#
+# SPDX-License-Identifier: MIT
+
+"""Cuts an lv_font_conv font down to the glyphs of the keymap's layer names.
+
+The layer names are read from the devicetree the build already produced, so
+the subset always matches the keymap being built. Digits and "Layer " are kept
+for layers without a name.
+"""
+
+import argparse
+import os
+import pickle
+import re
+import sys
+
+FALLBACK_TEXT = "Layer 0123456789"
+
+# lv_font_fmt_txt_glyph_dsc_t packs into eight bytes
+GLYPH_DSC_SIZE = 8
+
+
+def layer_names(edt_pickle, zephyr_base):
+    # The pickled EDT refers to edtlib's classes
+    sys.path.insert(0, os.path.join(zephyr_base, "scripts", "dts", "python-devicetree", "src"))
+    with open(edt_pickle, "rb") as f:
+        edt = pickle.load(f)
+
+    names = []
+    for keymap in edt.compat2okay.get("zmk,keymap", []):
+        for layer in keymap.children.values():
+            for prop in ("display-name", "label"):
+                if prop in layer.props:
+                    names.append(layer.props[prop].val)
+                    break
+    return names
+
+
+def c_array(src, name):
+    match = re.search(r"\b" + name + r"\[\]\s*=\s*\{(.*?)\};", src, re.S)
+    return match.group(1) if match else None
+
+
+def c_ints(body):
+    body = re.sub(r"/\*.*?\*/", "", body, flags=re.S)
+    return [int(v, 0) for v in re.findall(r"-?(?:0x[0-9a-fA-F]+|\d+)", body)]
+
+
+def c_field(src, name, default=None):
+    match = re.search(r"\." + name + r"\s*=\s*([^,\n]+)", src)
+    return match.group(1).strip() if match else default
+
+
+class Font:
+    def __init__(self, path):
+        with open(path, encoding="utf-8") as f:
+            src = f.read()
+
+        bitmap = c_array(src, "glyph_bitmap")
+        # lv_font_conv writes one /* U+XXXX */ comment per glyph, in glyph id order
+        self.codepoints = [int(cp, 16) for cp in re.findall(r"/\* U\+([0-9A-Fa-f]+)", bitmap)]
+        self.bitmap = c_ints(bitmap)
+
+        self.glyphs = []
+        for entry in re.findall(r"\{([^{}]*\.bitmap_index[^{}]*)\}", c_array(src, "glyph_dsc")):
+            self.glyphs.append({k: int(v) for k, v in re.findall(r"\.(\w+)\s*=\s*(-?\d+)", entry)})
+
+        if len(self.glyphs) != len(self.codepoints) + 1:
+            raise ValueError(f"{path}: {len(self.glyphs)} glyph descriptors "
+                             f"for {len(self.codepoints)} glyphs")
+
+        self.kern_left = self.kern_right = self.kern_values = None
+        if c_array(src, "kern_class_values") is not None:
+            self.kern_left = c_ints(c_array(src, "kern_left_class_mapping"))
+            self.kern_right = c_ints(c_array(src, "kern_right_class_mapping"))
+            self.kern_values = c_ints(c_array(src, "kern_class_values"))
+            self.kern_left_cnt = int(c_field(src, "left_class_cnt"))
+            self.kern_right_cnt = int(c_field(src, "right_class_cnt"))
+
+        self.kern_scale = c_field(src, "kern_scale", "0")
+        self.bpp = c_field(src, "bpp")
+        self.bitmap_format = c_field(src, "bitmap_format", "0")
+        self.line_height = c_field(src, "line_height")
+        self.base_line = c_field(src, "base_line")
+        self.subpx = c_field(src, "subpx", "LV_FONT_SUBPX_NONE")
+        self.underline_position = c_field(src, "underline_position", "0")
+        self.underline_thickness = c_field(src, "underline_thickness", "0")
+
+    def glyph_bitmap(self, glyph_id):
+        start = self.glyphs[glyph_id]["bitmap_index"]
+        if glyph_id + 1 < len(self.glyphs):
+            end = self.glyphs[glyph_id + 1]["bitmap_index"]
+        else:
+            end = len(self.bitmap)
+        return self.bitmap[start:end]
+
+    def size(self):
+        size = len(self.bitmap) + GLYPH_DSC_SIZE * len(self.glyphs) + 2 * len(self.codepoints)
+        if self.kern_values is not None:
+            size += len(self.kern_left) + len(self.kern_right) + len(self.kern_values)
+        return size
+
+
+def hex_rows(values, indent="    ", per_row=16):
+    rows = []
+    for i in range(0, len(values), per_row):
+        rows.append(indent + ", ".join(f"0x{v:02x}" for v in values[i:i + per_row]) + ",")
+    return rows
+
+
+def write_subset(font, glyph_ids, name, source, out):
+    lines = [
+        f"// Generated by font_subset.py from {os.path.basename(source)}, do not edit",
+        "",
+        "#include <lvgl.h>",
+        "",
+        "static LV_ATTRIBUTE_LARGE_CONST const uint8_t glyph_bitmap[] = {",
+    ]
+
+    bitmap_index = 0
+    glyph_dsc = ["    {.bitmap_index = 0, .adv_w = 0, .box_w = 0, .box_h = 0, .ofs_x = 0, .ofs_y = 0}, "
+                 "// id = 0 reserved"]
+    for glyph_id in glyph_ids:
+        glyph = font.glyphs[glyph_id]
+        data = font.glyph_bitmap(glyph_id)
+        char = chr(font.codepoints[glyph_id - 1])
+        lines.append(f"    // U+{font.codepoints[glyph_id - 1]:04X} {char!r}")
+        lines += hex_rows(data)
+        glyph_dsc.append(f"    {{.bitmap_index = {bitmap_index}, .adv_w = {glyph['adv_w']}, "
+                         f".box_w = {glyph['box_w']}, .box_h = {glyph['box_h']}, "
+                         f".ofs_x = {glyph['ofs_x']}, .ofs_y = {glyph['ofs_y']}}},")
+        bitmap_index += len(data)
+    if bitmap_index == 0:
+        lines.append("    0x00,")
+    lines += ["};", "", "static const lv_font_fmt_txt_glyph_dsc_t glyph_dsc[] = {"]
+    lines += glyph_dsc
+    lines += ["};", ""]
+
+    codepoints = [font.codepoints[glyph_id - 1] for glyph_id in glyph_ids]
+    range_start = codepoints[0]
+    lines += [
+        "static const uint16_t unicode_list_0[] = {",
+        "    " + ", ".join(f"0x{cp - range_start:x}" for cp in codepoints) + ",",
+        "};",
+        "",
+        "static const lv_font_fmt_txt_cmap_t cmaps[] = {",
+        f"    {{.range_start = {range_start}, .range_length = {codepoints[-1] - range_start + 1}, "
+        f".glyph_id_start = 1, .unicode_list = unicode_list_0, .glyph_id_ofs_list = NULL, "
+        f".list_length = {len(codepoints)}, .type = LV_FONT_FMT_TXT_CMAP_SPARSE_TINY}},",
+        "};",
+        "",
+    ]
+
+    kern = font.kern_values is not None
+    if kern:
+        left = [0] + [font.kern_left[glyph_id] for glyph_id in glyph_ids]
+        right = [0] + [font.kern_right[glyph_id] for glyph_id in glyph_ids]
+        # The class tables are small next to the bitmaps, so they are kept whole
+        lines += [
+            "static const uint8_t kern_left_class_mapping[] = {",
+            "    " + ", ".join(map(str, left)) + ",",
+            "};",
+            "",
+            "static const uint8_t kern_right_class_mapping[] = {",
+            "    " + ", ".join(map(str, right)) + ",",
+            "};",
+            "",
+            "static const int8_t kern_class_values[] = {",
+        ]
+        for i in range(0, len(font.kern_values), font.kern_right_cnt):
+            row = font.kern_values[i:i + font.kern_right_cnt]
+            lines.append("    " + ", ".join(map(str, row)) + ",")
+        lines += [
+            "};",
+            "",
+            "static const lv_font_fmt_txt_kern_classes_t kern_classes = {",
+            "    .class_pair_values = kern_class_values,",
+            "    .left_class_mapping = kern_left_class_mapping,",
+            "    .right_class_mapping = kern_right_class_mapping,",
+            f"    .left_class_cnt = {font.kern_left_cnt},",
+            f"    .right_class_cnt = {font.kern_right_cnt},",
+            "};",
+            "",
+        ]
+
+    lines += [
+        "#if LV_VERSION_CHECK(8, 0, 0)",
+        "static lv_font_fmt_txt_glyph_cache_t cache;",
+        "static const lv_font_fmt_txt_dsc_t font_dsc = {",
+        "#else",
+        "static lv_font_fmt_txt_dsc_t font_dsc = {",
+        "#endif",
+        "    .glyph_bitmap = glyph_bitmap,",
+        "    .glyph_dsc = glyph_dsc,",
+        "    .cmaps = cmaps,",
+        f"    .kern_dsc = {'&kern_classes' if kern else 'NULL'},",
+        f"    .kern_scale = {font.kern_scale if kern else 0},",
+        "    .cmap_num = 1,",
+        f"    .bpp = {font.bpp},",
+        f"    .kern_classes = {1 if kern else 0},",
+        f"    .bitmap_format = {font.bitmap_format},",
+        "#if LV_VERSION_CHECK(8, 0, 0)",
+        "    .cache = &cache",
+        "#endif",
+        "};",
+        "",
+        f"const lv_font_t {name} = {{",
+        "    .get_glyph_dsc = lv_font_get_glyph_dsc_fmt_txt,",
+        "    .get_glyph_bitmap = lv_font_get_bitmap_fmt_txt,",
+        f"    .line_height = {font.line_height},",
+        f"    .base_line = {font.base_line},",
+        f"    .subpx = {font.subpx},",
+        f"    .underline_position = {font.underline_position},",
+        f"    .underline_thickness = {font.underline_thickness},",
+        "    .dsc = &font_dsc,",
+        "};",
+    ]
+
+    out.write("\n".join(lines) + "\n")
+
+    size = bitmap_index + GLYPH_DSC_SIZE * (len(glyph_ids) + 1) + 2 * len(glyph_ids)
+    if kern:
+        size += len(left) + len(right) + len(font.kern_values)
+    return size
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--font", required=True, help="lv_font_conv C source to cut down")
+    parser.add_argument("--edt-pickle", required=True, help="edt.pickle of the build")
+    parser.add_argument("--zephyr-base", required=True)
+    parser.add_argument("--name", required=True, help="name of the generated lv_font_t")
+    parser.add_argument("--output", required=True)
+    args = parser.parse_args()
+
+    font = Font(args.font)
+    text = FALLBACK_TEXT + "".join(layer_names(args.edt_pickle, args.zephyr_base))
+
+    glyph_ids = []
+    missing = set()
+    for cp in sorted(set(map(ord, text))):
+        if cp in font.codepoints:
+            glyph_ids.append(font.codepoints.index(cp) + 1)
+        else:
+            missing.add(chr(cp))
+
+    if missing:
+        print(f"warning: {os.path.basename(args.font)} has no glyph for "
+              f"{' '.join(map(repr, sorted(missing)))}, layer names will show gaps")
+
+    with open(args.output, "w", encoding="utf-8") as out:
+        size = write_subset(font, glyph_ids, args.name, args.font, out)
+
+    print(f"Layer name font: {len(glyph_ids)} of {len(font.codepoints)} glyphs, "
+          f"{size} of {font.size()} bytes ({font.size() - size} bytes saved)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,324 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/event_manager.h>
+#include <zmk/events/battery_state_changed.h>
+#include <zmk/usb.h>
+
+#include "battery_history.h"
+
+#define HISTORY_SIZE CONFIG_ZMK_DONGLE_DISPLAY_BATTERY_HISTORY_SIZE
+
+// Smaller drops are mostly the noise of the level measurement
+#define MIN_DROP 2
+// Levels come from the voltage, which recovers by a few percent when the load
+// drops. Only larger rises are taken for a charge.
+#define MAX_NOISE_RISE 3
+
+struct battery_sample {
+    uint32_t minutes : 24;
+    uint32_t level : 8;
+};
+
+// The last level changes of one battery, oldest first from start
+struct battery_ring {
+    struct battery_sample samples[HISTORY_SIZE];
+    uint8_t start;
+    uint8_t count;
+};
+
+// Saved as one blob, with minutes being the history clock at the time
+static struct battery_history {
+    uint32_t minutes;
+    struct battery_ring rings[ZMK_DONGLE_DISPLAY_BATTERY_SOURCES];
+} history;
+
+static struct k_spinlock lock;
+
+// The history clock only runs while the dongle does. Peripherals discharging
+// while it is off make the rate look faster, so estimates err on the short side.
+static uint32_t clock_base;
+
+static uint32_t history_minutes(void) {
+    return clock_base + k_uptime_get() / (60 * MSEC_PER_SEC);
+}
+
+static const struct battery_sample *ring_newest(const struct battery_ring *ring) {
+    return &ring->samples[(ring->start + ring->count - 1) % HISTORY_SIZE];
+}
+
+static bool ring_record_at(struct battery_ring *ring, uint32_t minutes, uint8_t level,
+                           bool charging) {
+    if (ring->count > 0) {
+        uint8_t newest = ring_newest(ring)->level;
+
+        if (level == newest) {
+            return false;
+        }
+        if (level > newest) {
+            // A charged battery starts its discharge over. Smaller rises keep
+            // the lower level, so a slow charge still adds up to a reset.
+            if (!charging && level <= newest + MAX_NOISE_RISE) {
+                return false;
+            }
+            ring->start = 0;
+            ring->count = 0;
+        }
+    }
+
+    if (ring->count == HISTORY_SIZE) {
+        ring->start = (ring->start + 1) % HISTORY_SIZE;
+        ring->count--;
+    }
+    ring->samples[(ring->start + ring->count) % HISTORY_SIZE] = (struct battery_sample){
+        .minutes = minutes,
+        .level = level,
+    };
+    ring->count++;
+    return true;
+}
+
+static uint16_t ring_estimate_at(const struct battery_ring *ring, uint32_t minutes, uint8_t level) {
+    if (ring->count == 0 || level == 0 || level > ring_newest(ring)->level + MAX_NOISE_RISE) {
+        return ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE;
+    }
+
+    // The level given is the newest point, whether or not it is recorded yet
+    const struct battery_sample *oldest = &ring->samples[ring->start];
+    int drop = oldest->level - level;
+    uint32_t elapsed = minutes - oldest->minutes;
+    if (drop < MIN_DROP || elapsed == 0) {
+        return ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE;
+    }
+
+    // Percent per minute in Q16, and from that the tenths of an hour left
+    uint64_t rate = ((uint64_t)drop << 16) / elapsed;
+    if (rate == 0) {
+        return ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE;
+    }
+    uint64_t tenths = ((uint64_t)level << 16) / (rate * 6);
+
+    return MIN(tenths, ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE - 1);
+}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static void battery_history_save_work_cb(struct k_work *work) {
+    struct battery_history saved;
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    history.minutes = history_minutes();
+    saved = history;
+    k_spin_unlock(&lock, key);
+
+    int ret = settings_save_one("dongle_display/battery/history", &saved, sizeof(saved));
+    if (ret < 0) {
+        LOG_ERR("Failed to save the battery history (%d)", ret);
+    }
+}
+
+static K_WORK_DELAYABLE_DEFINE(battery_history_save_work, battery_history_save_work_cb);
+
+static int battery_history_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                                        void *cb_arg) {
+    const char *next;
+    struct battery_history loaded;
+
+    if (!settings_name_steq(name, "history", &next) || next != NULL) {
+        return -ENOENT;
+    }
+    // A history saved with another size or number of peripherals is dropped
+    if (len != sizeof(loaded)) {
+        return -EINVAL;
+    }
+
+    int ret = read_cb(cb_arg, &loaded, sizeof(loaded));
+    if (ret < 0) {
+        return ret;
+    }
+
+    for (int i = 0; i < ZMK_DONGLE_DISPLAY_BATTERY_SOURCES; i++) {
+        struct battery_ring *ring = &loaded.rings[i];
+        if (ring->start >= HISTORY_SIZE || ring->count > HISTORY_SIZE) {
+            *ring = (struct battery_ring){0};
+        }
+    }
+
+    // Levels reported before the settings were loaded are replaced as well
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    history = loaded;
+    clock_base = loaded.minutes;
+    k_spin_unlock(&lock, key);
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(dongle_display_battery, "dongle_display/battery", NULL,
+                               battery_history_settings_set, NULL, NULL);
+#endif
+
+static void battery_history_record(uint8_t source, uint8_t level) {
+    // Disconnected peripherals report 0, which says nothing about their charge
+    if (source >= ZMK_DONGLE_DISPLAY_BATTERY_SOURCES || level == 0) {
+        return;
+    }
+
+    // Only the dongle's own battery is known to charge from its USB port
+    bool charging = false;
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
+    charging = source == ZMK_DONGLE_DISPLAY_BATTERY_SOURCE_CENTRAL && zmk_usb_is_powered();
+#endif
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool changed = ring_record_at(&history.rings[source], history_minutes(), level, charging);
+    k_spin_unlock(&lock, key);
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+    // Already scheduled saves are left alone, so changes are batched into one
+    // write and writes are at least the save interval apart
+    if (changed) {
+        k_work_schedule(&battery_history_save_work,
+                        K_MINUTES(CONFIG_ZMK_DONGLE_DISPLAY_BATTERY_HISTORY_SAVE_INTERVAL_MIN));
+    }
+#else
+    ARG_UNUSED(changed);
+#endif
+}
+
+uint16_t zmk_dongle_display_battery_estimate(uint8_t source, uint8_t level) {
+    if (source >= ZMK_DONGLE_DISPLAY_BATTERY_SOURCES) {
+        return ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint16_t estimate = ring_estimate_at(&history.rings[source], history_minutes(), level);
+    k_spin_unlock(&lock, key);
+    return estimate;
+}
+
+void zmk_dongle_display_battery_format_estimate(char *buf, size_t len, uint16_t estimate) {
+    if (estimate == ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE) {
+        buf[0] = '\0';
+    } else if (estimate < 100) {
+        // Tenths only where they still mean something
+        snprintf(buf, len, "%u.%uh", estimate / 10, estimate % 10);
+    } else {
+        snprintf(buf, len, "%uh", estimate / 10);
+    }
+}
+
+static int battery_history_listener(const zmk_event_t *eh) {
+    const struct zmk_peripheral_battery_state_changed *peripheral =
+        as_zmk_peripheral_battery_state_changed(eh);
+    if (peripheral != NULL) {
+        battery_history_record(ZMK_DONGLE_DISPLAY_BATTERY_SOURCE_PERIPHERAL(peripheral->source),
+                               peripheral->state_of_charge);
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    const struct zmk_battery_state_changed *central = as_zmk_battery_state_changed(eh);
+    if (central != NULL) {
+        battery_history_record(ZMK_DONGLE_DISPLAY_BATTERY_SOURCE_CENTRAL,
+                               central->state_of_charge);
+    }
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(dongle_display_battery_history, battery_history_listener);
+ZMK_SUBSCRIPTION(dongle_display_battery_history, zmk_peripheral_battery_state_changed);
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_DONGLE_BATTERY)
+ZMK_SUBSCRIPTION(dongle_display_battery_history, zmk_battery_state_changed);
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+struct discharge_point {
+    uint16_t minutes;
+    uint8_t level;
+};
+
+struct discharge_curve {
+    const char *name;
+    const struct discharge_point *points;
+    size_t len;
+    uint8_t noise; // every third report is this much higher, as with a varying load
+};
+
+static const struct discharge_point linear_slow[] = {{0, 100}, {1200, 0}};
+static const struct discharge_point linear_fast[] = {{0, 100}, {300, 0}};
+// Quick drop off the full charge, a long plateau and a knee below 25%, like a LiPo cell
+static const struct discharge_point lipo[] = {{0, 100}, {60, 90}, {600, 25}, {720, 10}, {780, 0}};
+
+static const struct discharge_curve curves[] = {
+    {"linear 5%/h", linear_slow, ARRAY_SIZE(linear_slow)},
+    {"linear 20%/h", linear_fast, ARRAY_SIZE(linear_fast)},
+    {"lipo 13h", lipo, ARRAY_SIZE(lipo)},
+    {"lipo noisy", lipo, ARRAY_SIZE(lipo), 2},
+};
+
+static uint8_t discharge_level(const struct discharge_curve *curve, uint32_t minutes) {
+    for (size_t i = 1; i < curve->len; i++) {
+        const struct discharge_point *from = &curve->points[i - 1];
+        const struct discharge_point *to = &curve->points[i];
+
+        if (minutes <= to->minutes) {
+            return from->level - (from->level - to->level) * (minutes - from->minutes) /
+                                     (to->minutes - from->minutes);
+        }
+    }
+    return curve->points[curve->len - 1].level;
+}
+
+// Feeds every curve minute by minute through a ring of its own, the way
+// reported levels would fill the history, and compares at every 10% step
+void zmk_dongle_display_battery_history_replay(void) {
+    for (size_t c = 0; c < ARRAY_SIZE(curves); c++) {
+        const struct discharge_curve *curve = &curves[c];
+        uint32_t end = curve->points[curve->len - 1].minutes;
+        struct battery_ring ring = {0};
+        uint32_t error = 0, estimates = 0;
+        uint8_t next_report = 90;
+
+        for (uint32_t minutes = 0; minutes <= end && next_report > 0; minutes++) {
+            uint8_t level = discharge_level(curve, minutes);
+
+            if (minutes % 3 == 0) {
+                level = MIN(level + curve->noise, 100);
+            }
+            ring_record_at(&ring, minutes, level, false);
+            if (level > next_report) {
+                continue;
+            }
+            next_report -= 10;
+
+            uint16_t estimate = ring_estimate_at(&ring, minutes, level);
+            uint16_t actual = (end - minutes) / 6;
+            char estimate_text[8] = "none", actual_text[8];
+
+            if (estimate != ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE) {
+                zmk_dongle_display_battery_format_estimate(estimate_text, sizeof(estimate_text),
+                                                           estimate);
+                error += abs(estimate - actual);
+                estimates++;
+            }
+            zmk_dongle_display_battery_format_estimate(actual_text, sizeof(actual_text), actual);
+            LOG_INF("bench battery %-12s at %3u%%: %5s left, estimated %5s", curve->name, level,
+                    actual_text, estimate_text);
+        }
+
+        if (estimates > 0) {
+            LOG_INF("bench battery %-12s estimates off by %u.%uh on average", curve->name,
+                    error / estimates / 10, error / estimates % 10);
+        }
+    }
+}
+#endif
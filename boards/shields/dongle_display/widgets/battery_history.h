@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/kernel.h>
+
+// The dongle itself is source 0, peripheral i reports as source i + 1
+#if IS_ENABLED(CONFIG_ZMK_SPLIT_BLE) && IS_ENABLED(CONFIG_ZMK_SPLIT_ROLE_CENTRAL)
+#define ZMK_DONGLE_DISPLAY_BATTERY_SOURCES (CONFIG_ZMK_SPLIT_BLE_CENTRAL_PERIPHERALS + 1)
+#else
+#define ZMK_DONGLE_DISPLAY_BATTERY_SOURCES 1
+#endif
+
+#define ZMK_DONGLE_DISPLAY_BATTERY_SOURCE_CENTRAL 0
+#define ZMK_DONGLE_DISPLAY_BATTERY_SOURCE_PERIPHERAL(index) ((index) + 1)
+
+// Returned while a source has not discharged far enough for an estimate
+#define ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE UINT16_MAX
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BATTERY_HISTORY)
+
+// Estimated time until the battery of source is empty, in tenths of an hour.
+// level is the charge just reported, which the history may not hold yet.
+uint16_t zmk_dongle_display_battery_estimate(uint8_t source, uint8_t level);
+
+// Formats an estimate the way the widgets show it, e.g. "3.5h" or "12h"
+void zmk_dongle_display_battery_format_estimate(char *buf, size_t len, uint16_t estimate);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+// Runs synthetic discharge curves through the estimator and logs how it fares
+void zmk_dongle_display_battery_history_replay(void);
+#endif
+
+#else
+
+static inline uint16_t zmk_dongle_display_battery_estimate(uint8_t source, uint8_t level) {
+    return ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE;
+}
+
+static inline void zmk_dongle_display_battery_format_estimate(char *buf, size_t len,
+                                                              uint16_t estimate) {
+    buf[0] = '\0';
+}
+
+#endif
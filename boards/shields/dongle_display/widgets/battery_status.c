@@ -18,8 +18,9 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <zmk/event_manager.h>
 #include <zmk/usb.h>
 
+#include "battery_history.h"
 #include "battery_status.h"
-#include "lvgl_compat.h"
+#include "widget_listener.h"
 
 #if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_DONGLE_BATTERY)
     #define SOURCE_OFFSET 1
@@ -31,7 +32,7 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #  define ZMK_SPLIT_BLE_PERIPHERAL_COUNT 0
 #endif
 
-#define BUFFER_SIZE 64
+#define BATTERY_SOURCES (ZMK_SPLIT_BLE_PERIPHERAL_COUNT + SOURCE_OFFSET)
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
@@ -39,74 +40,105 @@ struct battery_state {
     uint8_t source;
     uint8_t level;
     bool usb_present;
+    uint16_t estimate;
+    bool reported; // false for sources without a report yet
 };
 
+// The listener keeps only the newest state until the display applies it, so
+// it carries every source and a report is not lost to another source's
+struct battery_states {
+    struct battery_state sources[MAX(BATTERY_SOURCES, 1)];
+};
+
+// Every source as last reported, only changed by the event side
+static struct battery_states reported_states;
+// Every source as last passed to the widgets, only used on the display thread
+static struct battery_states shown_states;
+
 struct battery_object {
     lv_obj_t *symbol;
     lv_obj_t *label;
-} battery_objects[ZMK_SPLIT_BLE_PERIPHERAL_COUNT + SOURCE_OFFSET];
-    
-static lv_color_t battery_image_buffer[ZMK_SPLIT_BLE_PERIPHERAL_COUNT + SOURCE_OFFSET][BUFFER_SIZE];
+    uint8_t shown_level; // level in the label, reports of other sources come in between
+    uint16_t shown_estimate;
+} battery_objects[BATTERY_SOURCES];
 
-static void draw_battery(lv_obj_t *canvas, uint8_t level, bool usb_present) {
-    lv_canvas_fill_bg(canvas, lv_color_black(), LV_OPA_COVER);
-    
-    lv_color_t white = lv_color_white();
-    
-    // Draw top contacts
-    lv_canvas_set_px(canvas, 0, 0, white);
-    lv_canvas_set_px(canvas, 4, 0, white);
-    
-    // Draw battery outline (border)
-    for (int x = 0; x < 5; x++) {
-        lv_canvas_set_px(canvas, x, 1, white);  // Top
-        lv_canvas_set_px(canvas, x, 7, white);  // Bottom
-    }
-    for (int y = 2; y < 7; y++) {
-        lv_canvas_set_px(canvas, 0, y, white);  // Left
-        lv_canvas_set_px(canvas, 4, y, white);  // Right
-    }
-    
-    // Determine fill level (from bottom going up)
-    int fill_lines = 0;
+LV_IMG_DECLARE(sym_battery_0);
+LV_IMG_DECLARE(sym_battery_1);
+LV_IMG_DECLARE(sym_battery_2);
+LV_IMG_DECLARE(sym_battery_3);
+LV_IMG_DECLARE(sym_battery_4);
+LV_IMG_DECLARE(sym_battery_5);
+
+#define BATTERY_FILL_LEVELS 6
+
+// Indexed by [usb_present][fill level], a charging battery is shown as outline only
+static const lv_img_dsc_t *const battery_symbols[2][BATTERY_FILL_LEVELS] = {
+    {
+        &sym_battery_0,
+        &sym_battery_1,
+        &sym_battery_2,
+        &sym_battery_3,
+        &sym_battery_4,
+        &sym_battery_5,
+    },
+    {
+        &sym_battery_0,
+        &sym_battery_0,
+        &sym_battery_0,
+        &sym_battery_0,
+        &sym_battery_0,
+        &sym_battery_0,
+    },
+};
+
+static uint8_t battery_fill_level(uint8_t level) {
     if (level > 90) {
-        fill_lines = 5;  // Full
+        return 5; // Full
     } else if (level > 70) {
-        fill_lines = 4;
+        return 4;
     } else if (level > 50) {
-        fill_lines = 3;
+        return 3;
     } else if (level > 30) {
-        fill_lines = 2;
+        return 2;
     } else if (level > 10) {
-        fill_lines = 1;
-    } else {
-        fill_lines = 0;  // Critical/empty
-    }
-    
-    // If USB present, show as outline only (charging)
-    if (!usb_present) {
-        // Fill from bottom up
-        for (int fill = 0; fill < fill_lines; fill++) {
-            int y = 6 - fill;  // Start from bottom (y=6) and go up
-            for (int x = 1; x < 4; x++) {
-                lv_canvas_set_px(canvas, x, y, white);
-            }
-        }
+        return 1;
     }
+    return 0; // Critical/empty
 }
 
 static void set_battery_symbol(lv_obj_t *widget, struct battery_state state) {
-    if (state.source >= ZMK_SPLIT_BLE_PERIPHERAL_COUNT + SOURCE_OFFSET) {
+    if (state.source >= BATTERY_SOURCES) {
         return;
     }
     LOG_DBG("source: %d, level: %d, usb: %d", state.source, state.level, state.usb_present);
     lv_obj_t *symbol = battery_objects[state.source].symbol;
     lv_obj_t *label = battery_objects[state.source].label;
 
-    draw_battery(symbol, state.level, state.usb_present);
-    lv_label_set_text_fmt(label, "%4u%% ", state.level);
+    const lv_img_dsc_t *src = battery_symbols[state.usb_present][battery_fill_level(state.level)];
+    if (lv_img_get_src(symbol) != src) {
+        lv_img_set_src(symbol, src);
+    }
+    if (state.level != battery_objects[state.source].shown_level ||
+        state.estimate != battery_objects[state.source].shown_estimate) {
+        if (state.estimate == ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE) {
+            lv_label_set_text_fmt(label, "%4u%% ", state.level);
+        } else {
+            char estimate[8];
+            zmk_dongle_display_battery_format_estimate(estimate, sizeof(estimate), state.estimate);
+            lv_label_set_text_fmt(label, "%s %u%% ", estimate, state.level);
+        }
+        // The label grows to the left, away from its symbol
+        lv_obj_align_to(label, symbol, LV_ALIGN_OUT_LEFT_MID, 0, 0);
+        battery_objects[state.source].shown_level = state.level;
+        battery_objects[state.source].shown_estimate = state.estimate;
+    }
     
-    if (state.level > 0 || state.usb_present) {
+    bool visible = state.level > 0 || state.usb_present;
+    if (visible == !lv_obj_has_flag(symbol, LV_OBJ_FLAG_HIDDEN)) {
+        return;
+    }
+
+    if (visible) {
         lv_obj_clear_flag(symbol, LV_OBJ_FLAG_HIDDEN);
         lv_obj_move_foreground(symbol);
         lv_obj_clear_flag(label, LV_OBJ_FLAG_HIDDEN);
@@ -117,9 +149,24 @@ static void set_battery_symbol(lv_obj_t *widget, struct battery_state state) {
     }
 }
 
-void battery_status_update_cb(struct battery_state state) {
-    struct zmk_widget_dongle_battery_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_battery_symbol(widget->obj, state); }
+static bool battery_state_eq(const struct battery_state *a, const struct battery_state *b) {
+    return a->source == b->source && a->level == b->level && a->usb_present == b->usb_present &&
+           a->estimate == b->estimate && a->reported == b->reported;
+}
+
+void battery_status_update_cb(struct battery_states states) {
+    for (int i = 0; i < BATTERY_SOURCES; i++) {
+        if (!states.sources[i].reported ||
+            battery_state_eq(&states.sources[i], &shown_states.sources[i])) {
+            continue;
+        }
+
+        struct zmk_widget_dongle_battery_status *widget;
+        SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+            set_battery_symbol(widget->obj, states.sources[i]);
+        }
+        shown_states.sources[i] = states.sources[i];
+    }
 }
 
 static struct battery_state peripheral_battery_status_get_state(const zmk_event_t *eh) {
@@ -127,30 +174,53 @@ static struct battery_state peripheral_battery_status_get_state(const zmk_event_
     return (struct battery_state){
         .source = ev->source + SOURCE_OFFSET,
         .level = ev->state_of_charge,
+        .estimate = zmk_dongle_display_battery_estimate(
+            ZMK_DONGLE_DISPLAY_BATTERY_SOURCE_PERIPHERAL(ev->source), ev->state_of_charge),
+        .reported = true,
     };
 }
 
 static struct battery_state central_battery_status_get_state(const zmk_event_t *eh) {
     const struct zmk_battery_state_changed *ev = as_zmk_battery_state_changed(eh);
+    uint8_t level = (ev != NULL) ? ev->state_of_charge : zmk_battery_state_of_charge();
     return (struct battery_state) {
         .source = 0,
-        .level = (ev != NULL) ? ev->state_of_charge : zmk_battery_state_of_charge(),
+        .level = level,
+        .estimate =
+            zmk_dongle_display_battery_estimate(ZMK_DONGLE_DISPLAY_BATTERY_SOURCE_CENTRAL, level),
+        .reported = true,
 #if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
         .usb_present = zmk_usb_is_powered(),
 #endif /* IS_ENABLED(CONFIG_USB_DEVICE_STACK) */
     };
 }
 
-static struct battery_state battery_status_get_state(const zmk_event_t *eh) { 
+static bool battery_states_eq(const struct battery_states *a, const struct battery_states *b) {
+    for (int i = 0; i < BATTERY_SOURCES; i++) {
+        if (!battery_state_eq(&a->sources[i], &b->sources[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static struct battery_states battery_status_get_state(const zmk_event_t *eh) { 
+    struct battery_state state;
     if (as_zmk_peripheral_battery_state_changed(eh) != NULL) {
-        return peripheral_battery_status_get_state(eh);
+        state = peripheral_battery_status_get_state(eh);
     } else {
-        return central_battery_status_get_state(eh);
+        state = central_battery_status_get_state(eh);
+    }
+
+    if (state.source < BATTERY_SOURCES) {
+        reported_states.sources[state.source] = state;
     }
+    return reported_states;
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_dongle_battery_status, struct battery_state,
-                            battery_status_update_cb, battery_status_get_state)
+DONGLE_DISPLAY_WIDGET_LISTENER_DIFFED(widget_dongle_battery_status, struct battery_states,
+                                      battery_status_update_cb, battery_status_get_state,
+                                      battery_states_eq)
 
 ZMK_SUBSCRIPTION(widget_dongle_battery_status, zmk_peripheral_battery_state_changed);
 
@@ -169,26 +239,32 @@ int zmk_widget_dongle_battery_status_init(struct zmk_widget_dongle_battery_statu
 
     lv_obj_set_size(widget->obj, LV_SIZE_CONTENT, LV_SIZE_CONTENT);
 
-    for (int i = 0; i < ZMK_SPLIT_BLE_PERIPHERAL_COUNT + SOURCE_OFFSET; i++) {
-        lv_obj_t *image_canvas = lv_canvas_create(widget->obj);
+    for (int i = 0; i < BATTERY_SOURCES; i++) {
+        lv_obj_t *image = lv_img_create(widget->obj);
         lv_obj_t *battery_label = lv_label_create(widget->obj);
 
-        lv_canvas_set_buffer(image_canvas, battery_image_buffer[i], 5, 8, LV_IMG_CF_INDEXED_1BIT);
+        lv_img_set_src(image, &sym_battery_0);
 
-        lv_obj_align(image_canvas, LV_ALIGN_TOP_RIGHT, 0, i * 10);
-        lv_obj_align_to(battery_label, image_canvas, LV_ALIGN_OUT_LEFT_MID, 0, 0);
+        lv_obj_align(image, LV_ALIGN_TOP_RIGHT, 0, i * 10);
+        lv_obj_align_to(battery_label, image, LV_ALIGN_OUT_LEFT_MID, 0, 0);
 
-        lv_obj_add_flag(image_canvas, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(image, LV_OBJ_FLAG_HIDDEN);
         lv_obj_add_flag(battery_label, LV_OBJ_FLAG_HIDDEN);
         
         battery_objects[i] = (struct battery_object){
-            .symbol = image_canvas,
+            .symbol = image,
             .label = battery_label,
+            .shown_level = UINT8_MAX,
+            .shown_estimate = ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE,
         };
     }
 
+    // the objects above start hidden, so every reported source is drawn again
+    shown_states = (struct battery_states){0};
+
     sys_slist_append(&widgets, &widget->node);
 
+    widget_dongle_battery_status_watch(widget->obj);
     widget_dongle_battery_status_init();
 
     return 0;
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+ 
+ #include "lvgl_compat.h"
+
+
+#ifndef LV_ATTRIBUTE_MEM_ALIGN
+#define LV_ATTRIBUTE_MEM_ALIGN
+#endif
+
+#ifndef LV_ATTRIBUTE_IMG_SYM_BATTERY_0
+#define LV_ATTRIBUTE_IMG_SYM_BATTERY_0
+#endif
+
+const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_SYM_BATTERY_0 uint8_t sym_battery_0_map[] = {
+  0xff, 0xff, 0xff, 0xff, 	/*Color of index 0*/
+  0x00, 0x00, 0x00, 0xff, 	/*Color of index 1*/
+
+  0x88, 0xf8, 0x88, 0x88, 0x88, 0x88, 0x88, 0xf8, 
+};
+
+const lv_img_dsc_t sym_battery_0 = {
+  .header.cf = LV_IMG_CF_INDEXED_1BIT,
+  .header.w = 5,
+  .header.h = 8,
+  .data_size = 16,
+  .data = sym_battery_0_map,
+};
+
+#ifndef LV_ATTRIBUTE_IMG_SYM_BATTERY_1
+#define LV_ATTRIBUTE_IMG_SYM_BATTERY_1
+#endif
+
+const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_SYM_BATTERY_1 uint8_t sym_battery_1_map[] = {
+  0xff, 0xff, 0xff, 0xff, 	/*Color of index 0*/
+  0x00, 0x00, 0x00, 0xff, 	/*Color of index 1*/
+
+  0x88, 0xf8, 0x88, 0x88, 0x88, 0x88, 0xf8, 0xf8, 
+};
+
+const lv_img_dsc_t sym_battery_1 = {
+  .header.cf = LV_IMG_CF_INDEXED_1BIT,
+  .header.w = 5,
+  .header.h = 8,
+  .data_size = 16,
+  .data = sym_battery_1_map,
+};
+
+#ifndef LV_ATTRIBUTE_IMG_SYM_BATTERY_2
+#define LV_ATTRIBUTE_IMG_SYM_BATTERY_2
+#endif
+
+const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_SYM_BATTERY_2 uint8_t sym_battery_2_map[] = {
+  0xff, 0xff, 0xff, 0xff, 	/*Color of index 0*/
+  0x00, 0x00, 0x00, 0xff, 	/*Color of index 1*/
+
+  0x88, 0xf8, 0x88, 0x88, 0x88, 0xf8, 0xf8, 0xf8, 
+};
+
+const lv_img_dsc_t sym_battery_2 = {
+  .header.cf = LV_IMG_CF_INDEXED_1BIT,
+  .header.w = 5,
+  .header.h = 8,
+  .data_size = 16,
+  .data = sym_battery_2_map,
+};
+
+#ifndef LV_ATTRIBUTE_IMG_SYM_BATTERY_3
+#define LV_ATTRIBUTE_IMG_SYM_BATTERY_3
+#endif
+
+const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_SYM_BATTERY_3 uint8_t sym_battery_3_map[] = {
+  0xff, 0xff, 0xff, 0xff, 	/*Color of index 0*/
+  0x00, 0x00, 0x00, 0xff, 	/*Color of index 1*/
+
+  0x88, 0xf8, 0x88, 0x88, 0xf8, 0xf8, 0xf8, 0xf8, 
+};
+
+const lv_img_dsc_t sym_battery_3 = {
+  .header.cf = LV_IMG_CF_INDEXED_1BIT,
+  .header.w = 5,
+  .header.h = 8,
+  .data_size = 16,
+  .data = sym_battery_3_map,
+};
+
+#ifndef LV_ATTRIBUTE_IMG_SYM_BATTERY_4
+#define LV_ATTRIBUTE_IMG_SYM_BATTERY_4
+#endif
+
+const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_SYM_BATTERY_4 uint8_t sym_battery_4_map[] = {
+  0xff, 0xff, 0xff, 0xff, 	/*Color of index 0*/
+  0x00, 0x00, 0x00, 0xff, 	/*Color of index 1*/
+
+  0x88, 0xf8, 0x88, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 
+};
+
+const lv_img_dsc_t sym_battery_4 = {
+  .header.cf = LV_IMG_CF_INDEXED_1BIT,
+  .header.w = 5,
+  .header.h = 8,
+  .data_size = 16,
+  .data = sym_battery_4_map,
+};
+
+#ifndef LV_ATTRIBUTE_IMG_SYM_BATTERY_5
+#define LV_ATTRIBUTE_IMG_SYM_BATTERY_5
+#endif
+
+const LV_ATTRIBUTE_MEM_ALIGN LV_ATTRIBUTE_LARGE_CONST LV_ATTRIBUTE_IMG_SYM_BATTERY_5 uint8_t sym_battery_5_map[] = {
+  0xff, 0xff, 0xff, 0xff, 	/*Color of index 0*/
+  0x00, 0x00, 0x00, 0xff, 	/*Color of index 1*/
+
+  0x88, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 0xf8, 
+};
+
+const lv_img_dsc_t sym_battery_5 = {
+  .header.cf = LV_IMG_CF_INDEXED_1BIT,
+  .header.w = 5,
+  .header.h = 8,
+  .data_size = 16,
+  .data = sym_battery_5_map,
+};
@@ -5,23 +5,18 @@
  */
 
 #include <zephyr/kernel.h>
-#include <zephyr/bluetooth/services/bas.h>
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #include <zmk/display.h>
 #include <zmk/event_manager.h>
-#include <zmk/events/wpm_state_changed.h>
-#include <zmk/wpm.h>
+#include <zmk/events/keycode_state_changed.h>
 
 #include "bongo_cat.h"
-
-#define SRC(array) (const void **)array, sizeof(array) / sizeof(lv_img_dsc_t *)
+#include "widget_listener.h"
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
-static int64_t last_anim_update_time = 0;
-#define ANIM_UPDATE_INTERVAL_MS 200  // Throttle: max 5 animation checks per second
 
 LV_IMG_DECLARE(bongo_cat_none);
 LV_IMG_DECLARE(bongo_cat_left1);
@@ -32,122 +27,271 @@ LV_IMG_DECLARE(bongo_cat_both1);
 LV_IMG_DECLARE(bongo_cat_both1_open);
 LV_IMG_DECLARE(bongo_cat_both2);
 
-#define ANIMATION_SPEED_IDLE 10000
-const lv_img_dsc_t *idle_imgs[] = {
-    &bongo_cat_both1_open,
-    &bongo_cat_both1_open,
-    &bongo_cat_both1_open,
-    &bongo_cat_both1,
+enum bongo_img {
+    bongo_img_none,
+    bongo_img_left1,
+    bongo_img_left2,
+    bongo_img_right1,
+    bongo_img_right2,
+    bongo_img_both1,
+    bongo_img_both1_open,
+    bongo_img_both2,
+    BONGO_IMG_COUNT,
 };
 
-#define ANIMATION_SPEED_SLOW 2000
-const lv_img_dsc_t *slow_imgs[] = {
-    &bongo_cat_left1,
-    &bongo_cat_both1,
-    &bongo_cat_both1,
-    &bongo_cat_right1,
-    &bongo_cat_both1,
-    &bongo_cat_both1,
-    &bongo_cat_left1,
-    &bongo_cat_both1,
-    &bongo_cat_both1,
+static const lv_img_dsc_t *const bongo_imgs[BONGO_IMG_COUNT] = {
+    [bongo_img_none] = &bongo_cat_none,
+    [bongo_img_left1] = &bongo_cat_left1,
+    [bongo_img_left2] = &bongo_cat_left2,
+    [bongo_img_right1] = &bongo_cat_right1,
+    [bongo_img_right2] = &bongo_cat_right2,
+    [bongo_img_both1] = &bongo_cat_both1,
+    [bongo_img_both1_open] = &bongo_cat_both1_open,
+    [bongo_img_both2] = &bongo_cat_both2,
 };
 
-#define ANIMATION_SPEED_MID 500
-const lv_img_dsc_t *mid_imgs[] = {
-    &bongo_cat_left2,
-    &bongo_cat_left1,
-    &bongo_cat_none,
-    &bongo_cat_right2,
-    &bongo_cat_right1,
-    &bongo_cat_none,
+// The images are LV_IMG_CF_INDEXED_1BIT: a two color palette, then rows
+// padded to whole bytes with the leftmost pixel in the top bit
+#define BONGO_WIDTH 50
+#define BONGO_HEIGHT 26
+#define BONGO_PALETTE_SIZE 8
+#define BONGO_STRIDE DIV_ROUND_UP(BONGO_WIDTH, 8)
+
+// Pixels that differ between two images, in image coordinates; empty when
+// x1 > x2. Filled once at boot, as the images never change.
+struct bongo_rect {
+    uint8_t x1, y1, x2, y2;
 };
 
-#define ANIMATION_SPEED_FAST 200
-const lv_img_dsc_t *fast_imgs[] = {
-    &bongo_cat_both2,
-    &bongo_cat_both1,
-    &bongo_cat_none,
-    &bongo_cat_none,
+static struct bongo_rect bongo_dirty[BONGO_IMG_COUNT][BONGO_IMG_COUNT];
+
+struct bongo_frame {
+    enum bongo_img img;
+    uint16_t duration_ms;
 };
 
-struct bongo_cat_wpm_status_state {
-    uint8_t wpm;
+// A sequence plays its frames once and then continues with next, or loops
+// when next is NULL
+struct bongo_sequence {
+    const struct bongo_frame *frames;
+    uint8_t len;
+    const struct bongo_sequence *next;
 };
 
-enum anim_state {
-    anim_state_none,
-    anim_state_idle,
-    anim_state_slow,
-    anim_state_mid,
-    anim_state_fast
-} current_anim_state;
-
-static void set_animation(lv_obj_t *animing, struct bongo_cat_wpm_status_state state) {
-    // Throttle animation state changes to prevent display thread flooding
-    int64_t now = k_uptime_get();
-    if ((now - last_anim_update_time) < ANIM_UPDATE_INTERVAL_MS) {
-        return;
+#define BONGO_SEQUENCE(name, next_seq, ...)                                                        \
+    static const struct bongo_frame name##_frames[] = {__VA_ARGS__};                               \
+    static const struct bongo_sequence name = {                                                    \
+        .frames = name##_frames,                                                                   \
+        .len = ARRAY_SIZE(name##_frames),                                                          \
+        .next = next_seq,                                                                          \
     }
-    last_anim_update_time = now;
-
-    if (state.wpm < 5) {
-        if (current_anim_state != anim_state_idle) {
-            lv_animimg_set_src(animing, SRC(idle_imgs));
-            lv_animimg_set_duration(animing, ANIMATION_SPEED_IDLE);
-            lv_animimg_set_repeat_count(animing, LV_ANIM_REPEAT_INFINITE);
-            lv_animimg_start(animing);
-            current_anim_state = anim_state_idle;
+
+// Resting with both paws down, blinking now and then
+BONGO_SEQUENCE(bongo_rest, NULL, {bongo_img_both1_open, 7500}, {bongo_img_both1, 2500});
+
+// Paws up and ready while typing continues
+BONGO_SEQUENCE(bongo_ready, &bongo_rest, {bongo_img_none, 1500});
+
+// One paw per keypress, alternating; both when presses pile up within a frame
+BONGO_SEQUENCE(bongo_tap_left, &bongo_ready, {bongo_img_left2, 40}, {bongo_img_left1, 80});
+BONGO_SEQUENCE(bongo_tap_right, &bongo_ready, {bongo_img_right2, 40}, {bongo_img_right1, 80});
+BONGO_SEQUENCE(bongo_tap_both, &bongo_ready, {bongo_img_both2, 120});
+
+static const struct bongo_sequence *current_sequence;
+static uint8_t current_frame;
+static lv_timer_t *frame_timer;
+
+// What the draw callback renders, only touched on the display thread
+static enum bongo_img drawn_img = bongo_img_both1_open;
+
+static uint32_t drawn_presses;
+static bool left_paw_next = true;
+
+static void bongo_dirty_rect(enum bongo_img from, enum bongo_img to, struct bongo_rect *rect) {
+    const uint8_t *a = bongo_imgs[from]->data + BONGO_PALETTE_SIZE;
+    const uint8_t *b = bongo_imgs[to]->data + BONGO_PALETTE_SIZE;
+
+    *rect = (struct bongo_rect){.x1 = UINT8_MAX, .y1 = UINT8_MAX};
+
+    for (uint8_t y = 0; y < BONGO_HEIGHT; y++) {
+        for (uint8_t byte = 0; byte < BONGO_STRIDE; byte++) {
+            uint8_t diff = a[y * BONGO_STRIDE + byte] ^ b[y * BONGO_STRIDE + byte];
+            if (diff == 0) {
+                continue;
+            }
+
+            rect->x1 = MIN(rect->x1, byte * 8 + __builtin_clz(diff) - 24);
+            rect->x2 = MAX(rect->x2, byte * 8 + 7 - __builtin_ctz(diff));
+            rect->y1 = MIN(rect->y1, y);
+            rect->y2 = y;
         }
-    } else if (state.wpm < 30) {
-        if (current_anim_state != anim_state_slow) {
-            lv_animimg_set_src(animing, SRC(slow_imgs));
-            lv_animimg_set_duration(animing, ANIMATION_SPEED_SLOW);
-            lv_animimg_set_repeat_count(animing, LV_ANIM_REPEAT_INFINITE);
-            lv_animimg_start(animing);
-            current_anim_state = anim_state_slow;
+    }
+}
+
+static void bongo_dirty_init(void) {
+    for (int from = 0; from < BONGO_IMG_COUNT; from++) {
+        for (int to = from + 1; to < BONGO_IMG_COUNT; to++) {
+            bongo_dirty_rect(from, to, &bongo_dirty[from][to]);
+            bongo_dirty[to][from] = bongo_dirty[from][to];
         }
-    } else if (state.wpm < 70) {
-        if (current_anim_state != anim_state_mid) {
-            lv_animimg_set_src(animing, SRC(mid_imgs));
-            lv_animimg_set_duration(animing, ANIMATION_SPEED_MID);
-            lv_animimg_set_repeat_count(animing, LV_ANIM_REPEAT_INFINITE);
-            lv_animimg_start(animing);
-            current_anim_state = anim_state_mid;
+        bongo_dirty[from][from] = (struct bongo_rect){.x1 = UINT8_MAX};
+    }
+}
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+static const char *const bongo_img_names[BONGO_IMG_COUNT] = {
+    "none", "left1", "left2", "right1", "right2", "both1", "both1_open", "both2",
+};
+
+// Bytes a page-addressed 1bpp panel like the SSD1306 receives for a
+// rectangle, with the image placed on a page boundary
+static uint16_t bongo_rect_bytes(const struct bongo_rect *rect) {
+    if (rect->x1 > rect->x2) {
+        return 0;
+    }
+    return (rect->x2 - rect->x1 + 1) * (rect->y2 / 8 - rect->y1 / 8 + 1);
+}
+
+static void bongo_dirty_log(void) {
+    const struct bongo_rect full = {0, 0, BONGO_WIDTH - 1, BONGO_HEIGHT - 1};
+    uint16_t full_bytes = bongo_rect_bytes(&full);
+
+    for (int from = 0; from < BONGO_IMG_COUNT; from++) {
+        for (int to = from + 1; to < BONGO_IMG_COUNT; to++) {
+            const struct bongo_rect *rect = &bongo_dirty[from][to];
+            uint16_t bytes = bongo_rect_bytes(rect);
+
+            LOG_INF("bench bongo %s <-> %s: %ux%u px, %u of %u bytes, %u saved",
+                    bongo_img_names[from], bongo_img_names[to],
+                    bytes ? rect->x2 - rect->x1 + 1 : 0, bytes ? rect->y2 - rect->y1 + 1 : 0,
+                    bytes, full_bytes, full_bytes - bytes);
         }
+    }
+}
+#endif
+
+static void bongo_cat_draw_cb(lv_event_t *e) {
+    lv_obj_t *obj = lv_event_get_target(e);
+    lv_draw_ctx_t *draw_ctx = lv_event_get_draw_ctx(e);
+
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
+
+    lv_draw_img_dsc_t img_dsc;
+    lv_draw_img_dsc_init(&img_dsc);
+    lv_obj_init_draw_img_dsc(obj, LV_PART_MAIN, &img_dsc);
+
+    // Clipped to the invalidated rectangle, so unchanged pixels are not redrawn
+    lv_draw_img(draw_ctx, &img_dsc, &coords, bongo_imgs[drawn_img]);
+}
+
+static void bongo_set_img(enum bongo_img img) {
+    const struct bongo_rect *rect = &bongo_dirty[drawn_img][img];
+    drawn_img = img;
+
+    if (rect->x1 > rect->x2) {
+        return;
+    }
+
+    struct zmk_widget_bongo_cat *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        lv_area_t coords;
+        lv_obj_get_coords(widget->obj, &coords);
+
+        lv_area_t area = {coords.x1 + rect->x1, coords.y1 + rect->y1, coords.x1 + rect->x2,
+                          coords.y1 + rect->y2};
+        lv_obj_invalidate_area(widget->obj, &area);
+    }
+}
+
+static void bongo_show_frame(void) {
+    const struct bongo_frame *frame = &current_sequence->frames[current_frame];
+
+    bongo_set_img(frame->img);
+
+    // The timer only fires when the frame is due, not on every display tick
+    lv_timer_set_period(frame_timer, frame->duration_ms);
+    lv_timer_reset(frame_timer);
+}
+
+static void bongo_play(const struct bongo_sequence *sequence) {
+    current_sequence = sequence;
+    current_frame = 0;
+    bongo_show_frame();
+}
+
+static void bongo_frame_timer_cb(lv_timer_t *timer) {
+    if (++current_frame < current_sequence->len) {
+        bongo_show_frame();
+    } else if (current_sequence->next != NULL) {
+        bongo_play(current_sequence->next);
     } else {
-        if (current_anim_state != anim_state_fast) {
-            lv_animimg_set_src(animing, SRC(fast_imgs));
-            lv_animimg_set_duration(animing, ANIMATION_SPEED_FAST);
-            lv_animimg_set_repeat_count(animing, LV_ANIM_REPEAT_INFINITE);
-            lv_animimg_start(animing);
-            current_anim_state = anim_state_fast;
-        }
+        current_frame = 0;
+        bongo_show_frame();
     }
 }
 
-struct bongo_cat_wpm_status_state bongo_cat_wpm_status_get_state(const zmk_event_t *eh) {
-    struct zmk_wpm_state_changed *ev = as_zmk_wpm_state_changed(eh);
-    // Add NULL check to prevent crash if event is NULL
-    return (struct bongo_cat_wpm_status_state) { .wpm = ev ? ev->state : 0 };
+struct bongo_cat_state {
+    uint32_t presses;
 };
 
-void bongo_cat_wpm_status_update_cb(struct bongo_cat_wpm_status_state state) {
-    struct zmk_widget_bongo_cat *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_animation(widget->obj, state); }
+static atomic_t presses;
+static atomic_t published_presses = ATOMIC_INIT(-1);
+
+static struct bongo_cat_state bongo_cat_get_state(const zmk_event_t *eh) {
+    const struct zmk_keycode_state_changed *ev = as_zmk_keycode_state_changed(eh);
+    if (ev != NULL && ev->state) {
+        atomic_inc(&presses);
+    }
+    return (struct bongo_cat_state){.presses = atomic_get(&presses)};
+}
+
+// Releases leave the count alone and never reach the display thread
+static bool bongo_cat_pressed(const struct bongo_cat_state *state) {
+    return atomic_set(&published_presses, state->presses) != state->presses;
+}
+
+static void bongo_cat_update_cb(struct bongo_cat_state state) {
+    uint32_t new_presses = state.presses - drawn_presses;
+    drawn_presses = state.presses;
+
+    if (new_presses == 0) {
+        return;
+    }
+
+    if (new_presses > 1) {
+        bongo_play(&bongo_tap_both);
+    } else {
+        bongo_play(left_paw_next ? &bongo_tap_left : &bongo_tap_right);
+        left_paw_next = !left_paw_next;
+    }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_bongo_cat, struct bongo_cat_wpm_status_state,
-                            bongo_cat_wpm_status_update_cb, bongo_cat_wpm_status_get_state)
+DONGLE_DISPLAY_WIDGET_LISTENER_FILTERED(widget_bongo_cat, struct bongo_cat_state,
+                                        bongo_cat_update_cb, bongo_cat_get_state,
+                                        bongo_cat_pressed)
 
-ZMK_SUBSCRIPTION(widget_bongo_cat, zmk_wpm_state_changed);
+ZMK_SUBSCRIPTION(widget_bongo_cat, zmk_keycode_state_changed);
 
 int zmk_widget_bongo_cat_init(struct zmk_widget_bongo_cat *widget, lv_obj_t *parent) {
-    widget->obj = lv_animimg_create(parent);
+    // Drawn by hand, so a frame change only invalidates the pixels it changes
+    widget->obj = lv_obj_create(parent);
+    lv_obj_set_size(widget->obj, BONGO_WIDTH, BONGO_HEIGHT);
+    lv_obj_add_event_cb(widget->obj, bongo_cat_draw_cb, LV_EVENT_DRAW_MAIN, NULL);
     lv_obj_center(widget->obj);
 
     sys_slist_append(&widgets, &widget->node);
 
+    if (frame_timer == NULL) {
+        bongo_dirty_init();
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+        bongo_dirty_log();
+#endif
+        frame_timer = lv_timer_create(bongo_frame_timer_cb, bongo_rest.frames[0].duration_ms, NULL);
+    }
+    bongo_play(&bongo_rest);
+
+    widget_bongo_cat_watch(widget->obj);
     widget_bongo_cat_init();
 
     return 0;
@@ -155,4 +299,4 @@ int zmk_widget_bongo_cat_init(struct zmk_widget_bongo_cat *widget, lv_obj_t *par
 
 lv_obj_t *zmk_widget_bongo_cat_obj(struct zmk_widget_bongo_cat *widget) {
     return widget->obj;
-}
\ No newline at end of file
+}
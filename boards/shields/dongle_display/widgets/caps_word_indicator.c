@@ -5,6 +5,7 @@
  */
 
 #include "caps_word_indicator.h"
+#include "widget_listener.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
@@ -43,8 +44,8 @@ static struct caps_word_indicator_state caps_word_indicator_get_state(const zmk_
     };
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_caps_word_indicator, struct caps_word_indicator_state,
-                            caps_word_indicator_update_cb, caps_word_indicator_get_state)
+DONGLE_DISPLAY_WIDGET_LISTENER(widget_caps_word_indicator, struct caps_word_indicator_state,
+                               caps_word_indicator_update_cb, caps_word_indicator_get_state)
 ZMK_SUBSCRIPTION(widget_caps_word_indicator, zmk_caps_word_state_changed);
 
 int zmk_widget_caps_word_indicator_init(struct zmk_widget_caps_word_indicator *widget,
@@ -69,6 +70,7 @@ int zmk_widget_caps_word_indicator_init(struct zmk_widget_caps_word_indicator *w
 
     sys_slist_append(&widgets, &widget->node);
 
+    widget_caps_word_indicator_watch(widget->obj);
     widget_caps_word_indicator_init();
     return 0;
 }
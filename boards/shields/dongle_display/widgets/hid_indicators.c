@@ -15,6 +15,7 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <zmk/events/hid_indicators_changed.h>
 
 #include "hid_indicators.h"
+#include "widget_listener.h"
 
 #define LED_NLCK 0x01
 #define LED_CLCK 0x02
@@ -54,6 +55,11 @@ void hid_indicators_update_cb(struct hid_indicators_state state) {
     SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_hid_indicators(widget->obj, state); }
 }
 
+static bool hid_indicators_state_eq(const struct hid_indicators_state *a,
+                                    const struct hid_indicators_state *b) {
+    return a->hid_indicators == b->hid_indicators;
+}
+
 static struct hid_indicators_state hid_indicators_get_state(const zmk_event_t *eh) {
     struct zmk_hid_indicators_changed *ev = as_zmk_hid_indicators_changed(eh);
     return (struct hid_indicators_state) {
@@ -61,8 +67,9 @@ static struct hid_indicators_state hid_indicators_get_state(const zmk_event_t *e
     };
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_hid_indicators, struct hid_indicators_state,
-                            hid_indicators_update_cb, hid_indicators_get_state)
+DONGLE_DISPLAY_WIDGET_LISTENER_DIFFED(widget_hid_indicators, struct hid_indicators_state,
+                                      hid_indicators_update_cb, hid_indicators_get_state,
+                                      hid_indicators_state_eq)
 
 ZMK_SUBSCRIPTION(widget_hid_indicators, zmk_hid_indicators_changed);
 
@@ -71,6 +78,7 @@ int zmk_widget_hid_indicators_init(struct zmk_widget_hid_indicators *widget, lv_
 
     sys_slist_append(&widgets, &widget->node);
 
+    widget_hid_indicators_watch(widget->obj);
     widget_hid_indicators_init();
 
     return 0;
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/display.h>
+
+#include "key_heatmap.h"
+#include "key_stats.h"
+
+#define HEATMAP_WIDTH 128
+#define HEATMAP_HEIGHT 32
+#define HEATMAP_STRIDE (HEATMAP_WIDTH / 8)
+
+// Keys are laid out in rows as the keymap lists them
+#define COLUMNS CONFIG_ZMK_DONGLE_DISPLAY_KEY_STATS_COLUMNS
+#define ROWS DIV_ROUND_UP(ZMK_KEYMAP_LEN, COLUMNS)
+#define CELL_WIDTH (HEATMAP_WIDTH / COLUMNS)
+#define CELL_HEIGHT (HEATMAP_HEIGHT / ROWS)
+#define OFFSET_X ((HEATMAP_WIDTH - COLUMNS * CELL_WIDTH) / 2)
+#define OFFSET_Y ((HEATMAP_HEIGHT - ROWS * CELL_HEIGHT) / 2)
+
+BUILD_ASSERT(CELL_WIDTH >= 2 && CELL_HEIGHT >= 2,
+             "The keymap does not fit the heatmap with one pixel between the keys");
+
+// The counters move while the heatmap is shown, so it is drawn again this often
+#define RENDER_MS 1000
+
+// A level of n lights the pixels whose threshold is below n, so every level
+// spreads its pixels evenly over the key
+#define LEVELS 16
+static const uint8_t dither[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+};
+
+static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
+
+// Drawn in the image recolor like the WPM graph
+static uint8_t heatmap_data[HEATMAP_STRIDE * HEATMAP_HEIGHT];
+static const lv_img_dsc_t heatmap_img = {
+    .header.cf = LV_IMG_CF_ALPHA_1BIT,
+    .header.w = HEATMAP_WIDTH,
+    .header.h = HEATMAP_HEIGHT,
+    .data_size = sizeof(heatmap_data),
+    .data = heatmap_data,
+};
+
+static lv_timer_t *render_timer;
+static bool shown;
+static uint32_t rendered_total;
+
+static void heatmap_set_pixel(uint16_t x, uint16_t y) {
+    heatmap_data[y * HEATMAP_STRIDE + x / 8] |= 0x80 >> (x % 8);
+}
+
+static void heatmap_draw_key(uint32_t position, uint8_t level) {
+    uint16_t left = OFFSET_X + (position % COLUMNS) * CELL_WIDTH;
+    uint16_t top = OFFSET_Y + (position / COLUMNS) * CELL_HEIGHT;
+
+    // Keys never pressed still show where they are
+    if (level == 0) {
+        heatmap_set_pixel(left + (CELL_WIDTH - 1) / 2, top + (CELL_HEIGHT - 1) / 2);
+        return;
+    }
+
+    // The last column and row of the cell stay clear between the keys
+    for (uint16_t y = top; y < top + CELL_HEIGHT - 1; y++) {
+        for (uint16_t x = left; x < left + CELL_WIDTH - 1; x++) {
+            if (dither[y % 4][x % 4] < level) {
+                heatmap_set_pixel(x, y);
+            }
+        }
+    }
+}
+
+static void heatmap_render(void) {
+    uint32_t max = 0, total = 0;
+
+    for (uint32_t i = 0; i < ZMK_KEYMAP_LEN; i++) {
+        uint32_t presses = zmk_dongle_display_key_presses(i);
+
+        max = MAX(max, presses);
+        total += presses;
+    }
+
+    // Presses only add up, so the same total means the same counters, barring
+    // a reset followed by exactly as many presses
+    if (total == rendered_total) {
+        return;
+    }
+    rendered_total = total;
+
+    memset(heatmap_data, 0, sizeof(heatmap_data));
+    for (uint32_t i = 0; i < ZMK_KEYMAP_LEN; i++) {
+        uint32_t presses = zmk_dongle_display_key_presses(i);
+
+        // Any press lights at least one pixel, the most pressed key all of them
+        heatmap_draw_key(i, presses ? MAX(DIV_ROUND_UP((uint64_t)presses * LEVELS, max), 1) : 0);
+    }
+
+    struct zmk_widget_key_heatmap *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { lv_obj_invalidate(widget->obj); }
+}
+
+static void heatmap_render_cb(lv_timer_t *timer) { heatmap_render(); }
+
+static void heatmap_toggle_work_cb(struct k_work *work) {
+    shown = !shown;
+
+    struct zmk_widget_key_heatmap *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+        if (shown) {
+            lv_obj_clear_flag(widget->obj, LV_OBJ_FLAG_HIDDEN);
+            lv_obj_move_foreground(widget->obj);
+        } else {
+            lv_obj_add_flag(widget->obj, LV_OBJ_FLAG_HIDDEN);
+        }
+    }
+
+    // The counters are only read while the heatmap is on the screen
+    if (shown) {
+        rendered_total = UINT32_MAX;
+        heatmap_render();
+        lv_timer_resume(render_timer);
+    } else {
+        lv_timer_pause(render_timer);
+    }
+}
+
+static K_WORK_DEFINE(heatmap_toggle_work, heatmap_toggle_work_cb);
+
+void zmk_widget_key_heatmap_toggle(void) {
+    k_work_submit_to_queue(zmk_display_work_q(), &heatmap_toggle_work);
+}
+
+int zmk_widget_key_heatmap_init(struct zmk_widget_key_heatmap *widget, lv_obj_t *parent) {
+    // Covers the widgets below it with the screen background
+    widget->obj = lv_obj_create(parent);
+    lv_obj_set_size(widget->obj, HEATMAP_WIDTH, HEATMAP_HEIGHT);
+    lv_obj_set_style_bg_color(widget->obj, lv_obj_get_style_bg_color(parent, LV_PART_MAIN), 0);
+    lv_obj_set_style_bg_opa(widget->obj, LV_OPA_COVER, 0);
+    lv_obj_set_style_border_width(widget->obj, 0, 0);
+    lv_obj_set_style_radius(widget->obj, 0, 0);
+    lv_obj_set_style_pad_all(widget->obj, 0, 0);
+    lv_obj_add_flag(widget->obj, LV_OBJ_FLAG_HIDDEN);
+
+    lv_obj_t *image = lv_img_create(widget->obj);
+    lv_img_set_src(image, &heatmap_img);
+    lv_obj_set_style_img_recolor(image, lv_obj_get_style_text_color(parent, LV_PART_MAIN), 0);
+    lv_obj_center(image);
+
+    if (render_timer == NULL) {
+        render_timer = lv_timer_create(heatmap_render_cb, RENDER_MS, NULL);
+        lv_timer_pause(render_timer);
+    }
+
+    sys_slist_append(&widgets, &widget->node);
+    return 0;
+}
+
+lv_obj_t *zmk_widget_key_heatmap_obj(struct zmk_widget_key_heatmap *widget) { return widget->obj; }
+
+// The only way to show it, so the heatmap depends on the shell
+static int cmd_keys_heatmap(const struct shell *sh, size_t argc, char **argv) {
+    zmk_widget_key_heatmap_toggle();
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((dongle_display, keys), heatmap, NULL, "Show or hide the key press heatmap",
+                 cmd_keys_heatmap, 1, 0);
@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+
+struct zmk_widget_key_heatmap {
+    sys_snode_t node;
+    lv_obj_t *obj;
+};
+
+int zmk_widget_key_heatmap_init(struct zmk_widget_key_heatmap *widget, lv_obj_t *parent);
+lv_obj_t *zmk_widget_key_heatmap_obj(struct zmk_widget_key_heatmap *widget);
+
+// Shows the heatmap over the rest of the screen, or hides it again. May be
+// called from any thread.
+void zmk_widget_key_heatmap_toggle(void);
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/sys/atomic.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/event_manager.h>
+#include <zmk/events/keycode_state_changed.h>
+#include <zmk/events/position_state_changed.h>
+
+#include "key_stats.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+#include "../refresh_probe.h"
+#endif
+
+#define COLUMNS CONFIG_ZMK_DONGLE_DISPLAY_KEY_STATS_COLUMNS
+
+// The event path only increments these, so it takes no lock and a reset
+// that clears them one by one loses no press
+static atomic_t presses[ZMK_KEYMAP_LEN];
+static atomic_t keycodes;
+
+struct key_stats_snapshot {
+    uint32_t presses[ZMK_KEYMAP_LEN];
+    uint32_t keycodes;
+};
+
+static void key_stats_take(struct key_stats_snapshot *snapshot, bool reset) {
+    for (int i = 0; i < ZMK_KEYMAP_LEN; i++) {
+        snapshot->presses[i] = reset ? atomic_clear(&presses[i]) : atomic_get(&presses[i]);
+    }
+    snapshot->keycodes = reset ? atomic_clear(&keycodes) : atomic_get(&keycodes);
+}
+
+uint32_t zmk_dongle_display_key_presses(uint32_t position) {
+    return position < ZMK_KEYMAP_LEN ? atomic_get(&presses[position]) : 0;
+}
+
+uint32_t zmk_dongle_display_keycode_presses(void) { return atomic_get(&keycodes); }
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static atomic_t save_scheduled;
+
+static void key_stats_save_work_cb(struct k_work *work) {
+    static struct key_stats_snapshot saved;
+
+    // Presses counted from here on schedule the next save
+    atomic_clear(&save_scheduled);
+    key_stats_take(&saved, false);
+
+    int ret = settings_save_one("dongle_display/keys/presses", &saved, sizeof(saved));
+    if (ret < 0) {
+        LOG_ERR("Failed to save the key press counters (%d)", ret);
+    }
+}
+
+static K_WORK_DELAYABLE_DEFINE(key_stats_save_work, key_stats_save_work_cb);
+
+static int key_stats_settings_set(const char *name, size_t len, settings_read_cb read_cb,
+                                  void *cb_arg) {
+    const char *next;
+    struct key_stats_snapshot loaded;
+
+    if (!settings_name_steq(name, "presses", &next) || next != NULL) {
+        return -ENOENT;
+    }
+    // Counters saved for a keymap of another size are dropped
+    if (len != sizeof(loaded)) {
+        return -EINVAL;
+    }
+
+    int ret = read_cb(cb_arg, &loaded, sizeof(loaded));
+    if (ret < 0) {
+        return ret;
+    }
+
+    // Presses counted before the settings were loaded are kept
+    for (int i = 0; i < ZMK_KEYMAP_LEN; i++) {
+        atomic_add(&presses[i], loaded.presses[i]);
+    }
+    atomic_add(&keycodes, loaded.keycodes);
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(dongle_display_keys, "dongle_display/keys", NULL,
+                               key_stats_settings_set, NULL, NULL);
+#endif
+
+static inline void key_stats_changed(void) {
+#if IS_ENABLED(CONFIG_SETTINGS)
+    // Only the first press after a save touches the work queue, so presses are
+    // batched into one write and writes are at least the save interval apart
+    if (!atomic_set(&save_scheduled, 1)) {
+        k_work_schedule(&key_stats_save_work,
+                        K_MINUTES(CONFIG_ZMK_DONGLE_DISPLAY_KEY_STATS_SAVE_INTERVAL_MIN));
+    }
+#endif
+}
+
+static inline void key_stats_count_position(uint32_t position) {
+    if (position < ZMK_KEYMAP_LEN) {
+        atomic_inc(&presses[position]);
+        key_stats_changed();
+    }
+}
+
+static inline void key_stats_count_keycode(void) {
+    atomic_inc(&keycodes);
+    key_stats_changed();
+}
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+// Stamps of the synthetic presses, which no real press carries. Baseline
+// presses take the same path but are not counted.
+#define STRESS_TIMESTAMP INT64_MIN
+#define STRESS_BASELINE_TIMESTAMP (INT64_MIN + 1)
+#endif
+
+static inline bool key_stats_counts(int64_t timestamp) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    return timestamp != STRESS_BASELINE_TIMESTAMP;
+#else
+    return true;
+#endif
+}
+
+static inline int key_stats_pass_on(int64_t timestamp) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    // Synthetic presses end here, so they never reach the keymap or the host
+    if (timestamp == STRESS_TIMESTAMP || timestamp == STRESS_BASELINE_TIMESTAMP) {
+        return ZMK_EV_EVENT_HANDLED;
+    }
+#endif
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+static int key_stats_listener(const zmk_event_t *eh) {
+    // Positions of every half arrive here, as the dongle is the central
+    const struct zmk_position_state_changed *position = as_zmk_position_state_changed(eh);
+    if (position != NULL) {
+        if (position->state && key_stats_counts(position->timestamp)) {
+            key_stats_count_position(position->position);
+        }
+        return key_stats_pass_on(position->timestamp);
+    }
+
+    const struct zmk_keycode_state_changed *keycode = as_zmk_keycode_state_changed(eh);
+    if (keycode == NULL) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+    if (keycode->state && key_stats_counts(keycode->timestamp)) {
+        key_stats_count_keycode();
+    }
+    return key_stats_pass_on(keycode->timestamp);
+}
+
+ZMK_LISTENER(dongle_display_key_stats, key_stats_listener);
+ZMK_SUBSCRIPTION(dongle_display_key_stats, zmk_position_state_changed);
+ZMK_SUBSCRIPTION(dongle_display_key_stats, zmk_keycode_state_changed);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+#define STRESS_PRESSES 100000
+// Presses raised before letting the other thread have a turn
+#define STRESS_BATCH 64
+#define STRESS_STACK_SIZE 1024
+
+static K_THREAD_STACK_DEFINE(stress_stack, STRESS_STACK_SIZE);
+static struct k_thread stress_thread;
+// Stamp of the presses of the running burst, set before either thread raises
+static int64_t stress_timestamp;
+
+// Dispatch starts at the counters' listener, so combos and hold-taps before
+// it in the listener order do not hold on to the synthetic presses either
+static void key_stats_stress_raise(uint32_t first, uint32_t count) {
+    for (uint32_t i = first; i < first + count; i++) {
+        struct zmk_position_state_changed_event position = {
+            .header.event = &zmk_event_zmk_position_state_changed,
+            .data = {.source = ZMK_POSITION_STATE_CHANGE_SOURCE_LOCAL,
+                     .position = i % ZMK_KEYMAP_LEN,
+                     .state = true,
+                     .timestamp = stress_timestamp},
+        };
+        struct zmk_keycode_state_changed_event keycode = {
+            .header.event = &zmk_event_zmk_keycode_state_changed,
+            .data = {.state = true, .timestamp = stress_timestamp},
+        };
+
+        ZMK_EVENT_RAISE_AT(position, dongle_display_key_stats);
+        ZMK_EVENT_RAISE_AT(keycode, dongle_display_key_stats);
+
+        if (i % STRESS_BATCH == STRESS_BATCH - 1) {
+            k_yield();
+        }
+    }
+}
+
+static void key_stats_stress_thread_main(void *first, void *count, void *p3) {
+    key_stats_stress_raise(POINTER_TO_UINT(first), POINTER_TO_UINT(count));
+}
+
+// Returns the ns per position and keycode event of one burst
+static uint32_t key_stats_stress_burst(int64_t timestamp) {
+    stress_timestamp = timestamp;
+
+    // Half of the presses come from a second thread of the same priority, and
+    // the two take turns, so both increment the counters during the burst
+    uint32_t start = zmk_dongle_display_probe_cycles();
+    k_thread_create(&stress_thread, stress_stack, K_THREAD_STACK_SIZEOF(stress_stack),
+                    key_stats_stress_thread_main, UINT_TO_POINTER(STRESS_PRESSES / 2),
+                    UINT_TO_POINTER(STRESS_PRESSES - STRESS_PRESSES / 2), NULL,
+                    k_thread_priority_get(k_current_get()), 0, K_NO_WAIT);
+    key_stats_stress_raise(0, STRESS_PRESSES / 2);
+    k_thread_join(&stress_thread, K_FOREVER);
+    uint32_t cycles = zmk_dongle_display_probe_cycles() - start;
+
+    return zmk_dongle_display_probe_cycles_to_ns(cycles) / STRESS_PRESSES;
+}
+
+void zmk_dongle_display_key_stats_stress(void) {
+    static struct key_stats_snapshot before, after;
+
+    // The same dispatch without the counting, for what the counters add to it
+    uint32_t baseline_ns = key_stats_stress_burst(STRESS_BASELINE_TIMESTAMP);
+
+    key_stats_take(&before, false);
+    uint32_t counted_ns = key_stats_stress_burst(STRESS_TIMESTAMP);
+    key_stats_take(&after, false);
+
+    // Real presses during the burst stay in the counters
+    uint32_t counted = 0;
+    for (int i = 0; i < ZMK_KEYMAP_LEN; i++) {
+        counted += after.presses[i] - before.presses[i];
+        atomic_sub(&presses[i],
+                   STRESS_PRESSES / ZMK_KEYMAP_LEN + (i < STRESS_PRESSES % ZMK_KEYMAP_LEN));
+    }
+    uint32_t keycodes_counted = after.keycodes - before.keycodes;
+    atomic_sub(&keycodes, STRESS_PRESSES);
+
+    if (counted != STRESS_PRESSES || keycodes_counted != STRESS_PRESSES) {
+        LOG_ERR("bench key stats counted %u positions and %u keycodes of %u presses", counted,
+                keycodes_counted, STRESS_PRESSES);
+    }
+    LOG_INF("bench key stats %u presses from 2 threads, %u ns per position and keycode event, "
+            "%u ns without counting, %d ns for the counters",
+            STRESS_PRESSES, counted_ns, baseline_ns, (int32_t)(counted_ns - baseline_ns));
+}
+#endif
+
+#if IS_ENABLED(CONFIG_SHELL)
+static void print_snapshot(const struct shell *sh, const struct key_stats_snapshot *snapshot) {
+    char line[COLUMNS * 7 + 8];
+    uint32_t total = 0;
+
+    for (int i = 0; i < ZMK_KEYMAP_LEN; i++) {
+        total += snapshot->presses[i];
+    }
+    shell_print(sh, "%u key presses, %u keycodes", total, snapshot->keycodes);
+
+    // One line per row of the layout, led by its first position
+    for (int row = 0; row < ZMK_KEYMAP_LEN; row += COLUMNS) {
+        int pos = snprintf(line, sizeof(line), "%3d:", row);
+
+        for (int i = row; i < MIN(row + COLUMNS, ZMK_KEYMAP_LEN) && pos < sizeof(line); i++) {
+            pos += snprintf(line + pos, sizeof(line) - pos, " %6u", snapshot->presses[i]);
+        }
+        shell_print(sh, "%s", line);
+    }
+}
+
+static int cmd_keys_show(const struct shell *sh, size_t argc, char **argv) {
+    static struct key_stats_snapshot snapshot;
+
+    key_stats_take(&snapshot, false);
+    print_snapshot(sh, &snapshot);
+    return 0;
+}
+
+static int cmd_keys_reset(const struct shell *sh, size_t argc, char **argv) {
+    static struct key_stats_snapshot snapshot;
+
+    key_stats_take(&snapshot, true);
+    print_snapshot(sh, &snapshot);
+#if IS_ENABLED(CONFIG_SETTINGS)
+    atomic_set(&save_scheduled, 1);
+    k_work_reschedule(&key_stats_save_work, K_NO_WAIT);
+#endif
+    shell_print(sh, "Counters reset");
+    return 0;
+}
+
+SHELL_SUBCMD_SET_CREATE(sub_dongle_display_keys, (dongle_display, keys));
+SHELL_SUBCMD_ADD((dongle_display), keys, &sub_dongle_display_keys, "Key press counters", NULL, 1,
+                 0);
+SHELL_SUBCMD_ADD((dongle_display, keys), show, NULL, "Print the press counters", cmd_keys_show, 1,
+                 0);
+SHELL_SUBCMD_ADD((dongle_display, keys), reset, NULL, "Print the press counters and reset them",
+                 cmd_keys_reset, 1, 0);
+#endif
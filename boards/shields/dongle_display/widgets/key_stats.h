@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zmk/matrix.h>
+
+// Presses of a key position since the counters were last reset, 0 past the keymap
+uint32_t zmk_dongle_display_key_presses(uint32_t position);
+
+// Keycode presses, which also counts those sent by combos and macros
+uint32_t zmk_dongle_display_keycode_presses(void);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+// Raises a burst of synthetic position and keycode presses from two threads
+// at the counters' listener, logs an error if any was not counted and the
+// time each took, then takes them out of the counters. The probe clock must
+// have run for a while, as it calibrates against the uptime since probe init.
+void zmk_dongle_display_key_stats_stress(void);
+#endif
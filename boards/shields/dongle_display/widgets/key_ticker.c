@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <dt-bindings/zmk/hid_usage_pages.h>
+#include <dt-bindings/zmk/modifiers.h>
+#include <zmk/event_manager.h>
+#include <zmk/events/keycode_state_changed.h>
+#include <zmk/hid.h>
+#include <zmk/keys.h>
+
+#include "key_ticker.h"
+
+#define LENGTH CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER_LENGTH
+#define RING_SIZE CONFIG_ZMK_DONGLE_DISPLAY_KEY_TICKER_RING_SIZE
+
+BUILD_ASSERT(IS_POWER_OF_TWO(RING_SIZE), "The key ticker ring size must be a power of two");
+
+// A key fits one atomic_t, so a slot is never read half written
+#define ENTRY(page, keycode, mods)                                                                 \
+    ((uint32_t)((page) & 0xFF) << 24 | ((mods) & 0xFF) << 16 | ((keycode) & 0xFFFF))
+#define ENTRY_PAGE(entry) ((entry) >> 24 & 0xFF)
+#define ENTRY_MODS(entry) ((entry) >> 16 & 0xFF)
+#define ENTRY_KEYCODE(entry) ((entry) & 0xFFFF)
+
+#define MODS_CTRL (MOD_LCTL | MOD_RCTL)
+#define MODS_SHIFT (MOD_LSFT | MOD_RSFT)
+#define MODS_ALT (MOD_LALT | MOD_RALT)
+#define MODS_GUI (MOD_LGUI | MOD_RGUI)
+
+// Keycode events are raised one at a time by ZMK's event processing, so the
+// event side is the single producer and the display thread the single consumer.
+// The producer never waits: a full ring is written over from its oldest entry,
+// and the consumer finds out from head how many of those it missed.
+static atomic_t ring[RING_SIZE];
+static atomic_t head; // keys ever pushed, only written by the event side
+static uint32_t tail; // keys ever drained, only used on the display thread
+static atomic_t dropped;
+
+static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
+
+// The newest key is at the right end
+static char text[LENGTH + 1];
+static bool space_pending;
+
+static lv_timer_t *drain_timer;
+
+static void ring_push(atomic_val_t entry) {
+    uint32_t index = atomic_get(&head);
+
+    atomic_set(&ring[index % RING_SIZE], entry);
+    atomic_set(&head, index + 1);
+}
+
+uint32_t zmk_widget_key_ticker_dropped(void) { return atomic_get(&dropped); }
+
+// US layout characters of the usages from 0x2D, unshifted and shifted
+static const char punctuation[] = "-=[]\\#;'`,./";
+static const char punctuation_shifted[] = "_+{}|~:\"~<>?";
+
+static const char *const named_keys[] = {
+    [0x28] = "RET",  [0x29] = "ESC",  [0x2A] = "BS",   [0x2B] = "TAB",  [0x39] = "CAPS",
+    [0x46] = "PSCR", [0x47] = "SLCK", [0x48] = "PAUS", [0x49] = "INS",  [0x4A] = "HOME",
+    [0x4B] = "PGUP", [0x4C] = "DEL",  [0x4D] = "END",  [0x4E] = "PGDN", [0x4F] = "RGHT",
+    [0x50] = "LEFT", [0x51] = "DOWN", [0x52] = "UP",
+};
+
+// Writes the key as typed, e.g. "a", "A", "C-c" or "S-TAB", and returns its length
+static int format_key(char *buf, size_t len, atomic_val_t entry) {
+    uint8_t page = ENTRY_PAGE(entry);
+    uint16_t keycode = ENTRY_KEYCODE(entry);
+    uint8_t mods = ENTRY_MODS(entry);
+    bool shift = mods & MODS_SHIFT;
+    char name[10] = {0};
+    char character = 0;
+
+    if (page == HID_USAGE_KEY && keycode >= 0x04 && keycode <= 0x1D) {
+        character = (shift ? 'A' : 'a') + keycode - 0x04;
+    } else if (page == HID_USAGE_KEY && keycode >= 0x1E && keycode <= 0x27) {
+        character = (shift ? "!@#$%^&*()" : "1234567890")[keycode - 0x1E];
+    } else if (page == HID_USAGE_KEY && keycode == 0x2C) {
+        character = '_';
+    } else if (page == HID_USAGE_KEY && keycode >= 0x2D && keycode <= 0x38) {
+        character = (shift ? punctuation_shifted : punctuation)[keycode - 0x2D];
+    } else if (page == HID_USAGE_KEY && keycode >= 0x3A && keycode <= 0x45) {
+        snprintf(name, sizeof(name), "F%u", keycode - 0x39);
+    } else if (page == HID_USAGE_KEY && keycode < ARRAY_SIZE(named_keys) &&
+               named_keys[keycode] != NULL) {
+        strncpy(name, named_keys[keycode], sizeof(name) - 1);
+    } else {
+        snprintf(name, sizeof(name), "%02X:%X", page, keycode);
+    }
+
+    // Shift is already in the character
+    int pos = snprintf(buf, len, "%s%s%s%s", (mods & MODS_CTRL) ? "C-" : "",
+                       (mods & MODS_ALT) ? "A-" : "", (mods & MODS_GUI) ? "G-" : "",
+                       (shift && character == 0) ? "S-" : "");
+    if (character != 0) {
+        return pos + snprintf(buf + pos, len - pos, "%c", character);
+    }
+    return pos + snprintf(buf + pos, len - pos, "%s", name);
+}
+
+static void ticker_push_char(char c) {
+    memmove(text, text + 1, LENGTH - 1);
+    text[LENGTH - 1] = c;
+}
+
+// Single characters run together like typed text, anything longer is set
+// apart by spaces
+static void ticker_append(atomic_val_t entry) {
+    char token[24];
+    int len = MIN(format_key(token, sizeof(token), entry), sizeof(token) - 1);
+
+    if (len > 1 || space_pending) {
+        ticker_push_char(' ');
+    }
+    for (int i = 0; i < len; i++) {
+        ticker_push_char(token[i]);
+    }
+    space_pending = len > 1;
+}
+
+static void ticker_drain_cb(lv_timer_t *timer) {
+    uint32_t index = atomic_get(&head);
+    bool appended = false;
+
+    while (tail != index) {
+        atomic_val_t entry = atomic_get(&ring[tail % RING_SIZE]);
+
+        // Once the event side is a whole ring ahead it is writing over this
+        // slot, so the entry may be a newer key and is dropped with the others
+        index = atomic_get(&head);
+        if (index - tail >= RING_SIZE) {
+            uint32_t lost = index - tail - (RING_SIZE - 1);
+
+            atomic_add(&dropped, lost);
+            tail += lost;
+            continue;
+        }
+
+        ticker_append(entry);
+        tail++;
+        appended = true;
+    }
+
+    if (!appended) {
+        return;
+    }
+
+    struct zmk_widget_key_ticker *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { lv_label_set_text(widget->obj, text); }
+}
+
+static int key_ticker_listener(const zmk_event_t *eh) {
+    const struct zmk_keycode_state_changed *ev = as_zmk_keycode_state_changed(eh);
+
+    // Modifiers show up on the keys they modify
+    if (ev == NULL || !ev->state || is_mod(ev->usage_page, ev->keycode)) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    ring_push(ENTRY(ev->usage_page, ev->keycode,
+                    ev->implicit_modifiers | zmk_hid_get_explicit_mods()));
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(widget_key_ticker, key_ticker_listener);
+ZMK_SUBSCRIPTION(widget_key_ticker, zmk_keycode_state_changed);
+
+int zmk_widget_key_ticker_init(struct zmk_widget_key_ticker *widget, lv_obj_t *parent) {
+    // Fixed-width glyphs keep every key in its column as the text moves
+    widget->obj = lv_label_create(parent);
+    lv_obj_set_style_text_font(widget->obj, &lv_font_unscii_8, 0);
+    lv_label_set_long_mode(widget->obj, LV_LABEL_LONG_CLIP);
+
+    if (drain_timer == NULL) {
+        memset(text, ' ', LENGTH);
+
+        // Drained once per display frame, like the coalesced widget updates
+        lv_disp_t *disp = lv_disp_get_default();
+        drain_timer = lv_timer_create(ticker_drain_cb, disp->refr_timer->period, NULL);
+    }
+    lv_label_set_text(widget->obj, text);
+
+    sys_slist_append(&widgets, &widget->node);
+    return 0;
+}
+
+lv_obj_t *zmk_widget_key_ticker_obj(struct zmk_widget_key_ticker *widget) { return widget->obj; }
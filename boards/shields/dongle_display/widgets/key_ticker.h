@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+
+struct zmk_widget_key_ticker {
+    sys_snode_t node;
+    lv_obj_t *obj;
+};
+
+int zmk_widget_key_ticker_init(struct zmk_widget_key_ticker *widget, lv_obj_t *parent);
+lv_obj_t *zmk_widget_key_ticker_obj(struct zmk_widget_key_ticker *widget);
+
+// Keys written over in the ring before the display thread got to them
+uint32_t zmk_widget_key_ticker_dropped(void);
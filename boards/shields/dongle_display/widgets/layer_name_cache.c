@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include "layer_name_cache.h"
+
+static uint8_t glyph_value(const uint8_t *bitmap, uint32_t bit, uint8_t bpp) {
+    uint8_t value = 0;
+
+    for (uint8_t i = 0; i < bpp; i++, bit++) {
+        value = (value << 1) | ((bitmap[bit / 8] >> (7 - bit % 8)) & 1);
+    }
+    return value;
+}
+
+// Glyph bitmaps are one bit stream over all rows, most significant bit first
+static void render_glyph(lv_img_dsc_t *img, const lv_font_glyph_dsc_t *glyph,
+                         const uint8_t *bitmap, lv_coord_t pos_x, lv_coord_t pos_y) {
+    uint8_t *data = (uint8_t *)img->data;
+    uint32_t stride = (img->header.w + 7) / 8;
+    uint8_t max = (1 << glyph->bpp) - 1;
+    uint32_t bit = 0;
+
+    for (lv_coord_t y = 0; y < glyph->box_h; y++) {
+        for (lv_coord_t x = 0; x < glyph->box_w; x++, bit += glyph->bpp) {
+            lv_coord_t px = pos_x + x;
+            lv_coord_t py = pos_y + y;
+
+            if (px < 0 || px >= img->header.w || py < 0 || py >= img->header.h) {
+                continue;
+            }
+            // LVGL mixes into a 1bpp display the same way, so the image matches a label
+            if (glyph_value(bitmap, bit, glyph->bpp) * LV_OPA_COVER / max > LV_OPA_50) {
+                data[py * stride + px / 8] |= 0x80 >> (px % 8);
+            }
+        }
+    }
+}
+
+static int render_name(struct zmk_dongle_display_layer_name *name, const char *text,
+                       const lv_font_t *font, lv_coord_t letter_space, lv_coord_t max_width) {
+    lv_coord_t width = lv_txt_get_width(text, strlen(text), font, letter_space, LV_TEXT_FLAG_NONE);
+    lv_coord_t height = lv_font_get_line_height(font);
+    uint32_t size = (MAX(width, 1) + 7) / 8 * height;
+
+    uint8_t *data = lv_mem_alloc(size);
+    if (data == NULL) {
+        return -ENOMEM;
+    }
+    memset(data, 0, size);
+
+    name->img = (lv_img_dsc_t){
+        .header.cf = LV_IMG_CF_ALPHA_1BIT,
+        .header.w = MAX(width, 1),
+        .header.h = height,
+        .data_size = size,
+        .data = data,
+    };
+    name->scroll = width > max_width;
+
+    // Same glyph placement and advance as lv_draw_label
+    uint32_t i = 0;
+    lv_coord_t x = 0;
+    uint32_t letter = _lv_txt_encoded_next(text, &i);
+
+    while (letter != 0) {
+        uint32_t next = _lv_txt_encoded_next(text, &i);
+        lv_font_glyph_dsc_t glyph;
+
+        if (lv_font_get_glyph_dsc(font, &glyph, letter, next) && glyph.box_w > 0) {
+            const uint8_t *bitmap = lv_font_get_glyph_bitmap(font, letter);
+            if (bitmap != NULL) {
+                render_glyph(&name->img, &glyph, bitmap, x + glyph.ofs_x,
+                             font->line_height - font->base_line - glyph.box_h - glyph.ofs_y);
+            }
+        }
+
+        lv_coord_t letter_w = lv_font_get_glyph_width(font, letter, next);
+        if (letter_w > 0) {
+            x += letter_w + letter_space;
+        }
+        letter = next;
+    }
+
+    return 0;
+}
+
+int zmk_dongle_display_layer_names_init(struct zmk_dongle_display_layer_names *cache,
+                                        const lv_font_t *font, lv_coord_t letter_space,
+                                        lv_coord_t max_width, const char *fallback) {
+    uint32_t bytes = 0;
+
+    for (uint8_t index = 0; index < ZMK_KEYMAP_LAYERS_LEN; index++) {
+        const char *text = zmk_keymap_layer_name(index);
+        char fallback_text[20];
+
+        if (text == NULL) {
+            snprintf(fallback_text, sizeof(fallback_text), fallback, index);
+            text = fallback_text;
+        }
+
+        int ret = render_name(&cache->names[index], text, font, letter_space, max_width);
+        if (ret < 0) {
+            LOG_ERR("No memory for the name of layer %u", index);
+            while (index-- > 0) {
+                lv_mem_free((void *)cache->names[index].img.data);
+            }
+            return ret;
+        }
+        bytes += cache->names[index].img.data_size;
+    }
+
+    LOG_DBG("Rendered %u layer names into %u bytes", ZMK_KEYMAP_LAYERS_LEN, bytes);
+    return 0;
+}
+
+const struct zmk_dongle_display_layer_name *
+zmk_dongle_display_layer_names_get(const struct zmk_dongle_display_layer_names *cache,
+                                   uint8_t index) {
+    return &cache->names[MIN(index, ZMK_KEYMAP_LAYERS_LEN - 1)];
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+
+#include <zmk/keymap.h>
+
+// One layer name, rendered once into a 1bpp alpha image
+struct zmk_dongle_display_layer_name {
+    lv_img_dsc_t img; // drawn in the image recolor of the object showing it
+    bool scroll;      // wider than the space given to the name
+};
+
+struct zmk_dongle_display_layer_names {
+    struct zmk_dongle_display_layer_name names[ZMK_KEYMAP_LAYERS_LEN];
+};
+
+// Renders the name of every layer with font and letter_space, or fallback
+// (a printf format taking the layer index) for layers without a name. Layer
+// names are taken as fixed from here on. Must run on the display thread.
+int zmk_dongle_display_layer_names_init(struct zmk_dongle_display_layer_names *cache,
+                                        const lv_font_t *font, lv_coord_t letter_space,
+                                        lv_coord_t max_width, const char *fallback);
+
+const struct zmk_dongle_display_layer_name *
+zmk_dongle_display_layer_names_get(const struct zmk_dongle_display_layer_names *cache,
+                                   uint8_t index);
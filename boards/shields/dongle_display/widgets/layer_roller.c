@@ -5,6 +5,10 @@
  */
 
 #include "layer_roller.h"
+#include "widget_listener.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_CACHE)
+#include "layer_name_cache.h"
+#endif
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
@@ -14,8 +18,22 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <zmk/event_manager.h>
 #include <zmk/keymap.h>
 
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_FONT_SUBSET)
+// Generated at build time from the keymap's layer names
+LV_FONT_DECLARE(lv_font_dongle_layer_names);
+#define LAYER_ROLLER_FONT lv_font_dongle_layer_names
+#else
+#define LAYER_ROLLER_FONT lv_font_montserrat_14
+#endif
+
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_CACHE)
+// Layer switches only swap images, unless the names could not be rendered
+static struct zmk_dongle_display_layer_names layer_names;
+static bool layer_names_cached;
+#endif
+
 struct layer_roller_state {
     uint8_t index;
     const char *label;
@@ -31,9 +49,25 @@ static void layer_roller_set_sel(lv_obj_t *label, struct layer_roller_state stat
     }
 }
 
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_CACHE)
+static void layer_roller_set_img(lv_obj_t *img, struct layer_roller_state state) {
+    const lv_img_dsc_t *src = &zmk_dongle_display_layer_names_get(&layer_names, state.index)->img;
+
+    if (lv_img_get_src(img) != src) {
+        lv_img_set_src(img, src);
+    }
+}
+#endif
+
 static void layer_roller_update_cb(struct layer_roller_state state) {
     struct zmk_widget_layer_roller *widget;
     SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_CACHE)
+        if (layer_names_cached) {
+            layer_roller_set_img(widget->obj, state);
+            continue;
+        }
+#endif
         layer_roller_set_sel(widget->obj, state);
     }
 }
@@ -46,19 +80,56 @@ static struct layer_roller_state layer_roller_get_state(const zmk_event_t *eh) {
     };
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_layer_roller, struct layer_roller_state, layer_roller_update_cb,
-                            layer_roller_get_state)
+static bool layer_roller_state_eq(const struct layer_roller_state *a,
+                                  const struct layer_roller_state *b) {
+    return a->index == b->index && a->label == b->label;
+}
+
+DONGLE_DISPLAY_WIDGET_LISTENER_DIFFED(widget_layer_roller, struct layer_roller_state,
+                                      layer_roller_update_cb, layer_roller_get_state,
+                                      layer_roller_state_eq)
 ZMK_SUBSCRIPTION(widget_layer_roller, zmk_layer_state_changed);
 
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_CACHE)
+static lv_obj_t *layer_roller_create_img(lv_obj_t *parent) {
+    static bool rendered;
+
+    if (!rendered) {
+        rendered = true;
+        layer_names_cached =
+            zmk_dongle_display_layer_names_init(
+                &layer_names, &LAYER_ROLLER_FONT,
+                lv_obj_get_style_text_letter_space(parent, LV_PART_MAIN),
+                lv_disp_get_hor_res(lv_obj_get_disp(parent)), "Layer %d") == 0;
+    }
+    if (!layer_names_cached) {
+        return NULL;
+    }
+
+    // The names are alpha images, drawn in the text color like a label
+    lv_obj_t *img = lv_img_create(parent);
+    lv_obj_set_style_img_recolor(img, lv_obj_get_style_text_color(parent, LV_PART_MAIN), 0);
+    return img;
+}
+#endif
+
 int zmk_widget_layer_roller_init(struct zmk_widget_layer_roller *widget, lv_obj_t *parent) {
-    widget->obj = lv_label_create(parent);
-    
-    // Style for large prominent layer display
-    lv_obj_set_style_text_align(widget->obj, LV_TEXT_ALIGN_CENTER, 0);
-    lv_obj_set_style_text_font(widget->obj, &lv_font_montserrat_14, 0);
-    
+    widget->obj = NULL;
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_CACHE)
+    widget->obj = layer_roller_create_img(parent);
+#endif
+
+    if (widget->obj == NULL) {
+        widget->obj = lv_label_create(parent);
+
+        // Style for large prominent layer display
+        lv_obj_set_style_text_align(widget->obj, LV_TEXT_ALIGN_CENTER, 0);
+        lv_obj_set_style_text_font(widget->obj, &LAYER_ROLLER_FONT, 0);
+    }
+
     sys_slist_append(&widgets, &widget->node);
 
+    widget_layer_roller_watch(widget->obj);
     widget_layer_roller_init();
     return 0;
 }
@@ -9,20 +9,200 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
+#include <zmk/activity.h>
 #include <zmk/display.h>
-#include <zmk/display/widgets/layer_status.h>
+#include <zmk/events/activity_state_changed.h>
 #include <zmk/events/layer_state_changed.h>
 #include <zmk/event_manager.h>
 #include <zmk/endpoints.h>
 #include <zmk/keymap.h>
 
+#include "layer_status.h"
+#include "widget_listener.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+#include "../refresh_probe.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_STRIP)
+#include "layer_name_cache.h"
+#endif
+
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
 struct layer_status_state {
     uint8_t index;
     const char *label;
+    bool active;
 };
 
+static lv_text_align_t layer_status_align(void) {
+    if (strcmp(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_TEXT_ALIGN, "right") == 0) {
+        return LV_TEXT_ALIGN_RIGHT;
+    } else if (strcmp(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_TEXT_ALIGN, "center") == 0) {
+        return LV_TEXT_ALIGN_CENTER;
+    }
+    return LV_TEXT_ALIGN_LEFT;
+}
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+static uint32_t draw_start;
+static atomic_t draws;
+static atomic_t draw_us;
+
+static void layer_status_draw_begin_cb(lv_event_t *e) {
+    draw_start = zmk_dongle_display_probe_cycles();
+}
+
+static void layer_status_draw_end_cb(lv_event_t *e) {
+    uint32_t cycles = zmk_dongle_display_probe_cycles() - draw_start;
+
+    atomic_inc(&draws);
+    atomic_add(&draw_us, zmk_dongle_display_probe_cycles_to_ns(cycles) / NSEC_PER_USEC);
+}
+
+void zmk_widget_layer_status_take_draw_stats(uint32_t *count, uint32_t *us) {
+    *count = atomic_clear(&draws);
+    *us = atomic_clear(&draw_us);
+}
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_STRIP)
+// Every name is rendered once; scrolling only moves where the strip is drawn
+static struct zmk_dongle_display_layer_names layer_names;
+static const struct zmk_dongle_display_layer_name *shown_name;
+
+static lv_timer_t *scroll_timer;
+static lv_coord_t scroll_gap;
+static lv_coord_t scroll_offset;
+static uint8_t scroll_cycles;
+
+static lv_coord_t layer_status_name_x(void) {
+    lv_coord_t space = CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_WIDTH - shown_name->img.header.w;
+
+    if (shown_name->scroll) {
+        return -scroll_offset;
+    }
+    switch (layer_status_align()) {
+    case LV_TEXT_ALIGN_RIGHT:
+        return space;
+    case LV_TEXT_ALIGN_CENTER:
+        return space / 2;
+    default:
+        return 0;
+    }
+}
+
+static void layer_status_draw_cb(lv_event_t *e) {
+    lv_obj_t *obj = lv_event_get_target(e);
+    lv_draw_ctx_t *draw_ctx = lv_event_get_draw_ctx(e);
+
+    if (shown_name == NULL) {
+        return;
+    }
+
+    lv_area_t obj_coords, clip;
+    lv_obj_get_coords(obj, &obj_coords);
+    if (!_lv_area_intersect(&clip, draw_ctx->clip_area, &obj_coords)) {
+        return;
+    }
+
+    lv_area_t coords = obj_coords;
+    coords.x1 += layer_status_name_x();
+    coords.x2 = coords.x1 + shown_name->img.header.w - 1;
+    coords.y2 = coords.y1 + shown_name->img.header.h - 1;
+
+    // The name images are alpha only and take the text color from the recolor
+    lv_draw_img_dsc_t img_dsc;
+    lv_draw_img_dsc_init(&img_dsc);
+    img_dsc.recolor = lv_obj_get_style_text_color(obj, LV_PART_MAIN);
+
+    // The strip reaches past the object while scrolling, but only its own rectangle is drawn
+    const lv_area_t *clip_area_ori = draw_ctx->clip_area;
+    draw_ctx->clip_area = &clip;
+
+    lv_draw_img(draw_ctx, &img_dsc, &coords, &shown_name->img);
+    if (shown_name->scroll) {
+        lv_area_move(&coords, shown_name->img.header.w + scroll_gap, 0);
+        lv_draw_img(draw_ctx, &img_dsc, &coords, &shown_name->img);
+    }
+
+    draw_ctx->clip_area = clip_area_ori;
+}
+
+static void layer_status_invalidate(void) {
+    struct zmk_widget_layer_status *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { lv_obj_invalidate(widget->obj); }
+}
+
+static void layer_status_scroll_timer_cb(lv_timer_t *timer) {
+    if (++scroll_offset < shown_name->img.header.w + scroll_gap) {
+        layer_status_invalidate();
+        return;
+    }
+
+    // A cycle ends with the name back at its start
+    scroll_offset = 0;
+    layer_status_invalidate();
+    if (CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_CYCLES > 0 && --scroll_cycles == 0) {
+        lv_timer_pause(timer);
+    }
+}
+
+static void layer_status_scroll_update(struct layer_status_state state) {
+    const struct zmk_dongle_display_layer_name *name =
+        zmk_dongle_display_layer_names_get(&layer_names, state.index);
+
+    if (name != shown_name) {
+        shown_name = name;
+        scroll_cycles = CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_CYCLES;
+        scroll_offset = 0;
+        layer_status_invalidate();
+    }
+
+    // Idle keyboards show the start of the name and stop scrolling until the next keypress
+    if (!name->scroll || !state.active) {
+        if (scroll_offset != 0) {
+            scroll_offset = 0;
+            layer_status_invalidate();
+        }
+        lv_timer_pause(scroll_timer);
+        return;
+    }
+
+    if (scroll_timer->paused) {
+        if (CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_CYCLES > 0 && scroll_cycles == 0) {
+            scroll_cycles = CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_CYCLES;
+        }
+        lv_timer_reset(scroll_timer);
+        lv_timer_resume(scroll_timer);
+    }
+}
+
+static lv_obj_t *layer_status_create_strip(lv_obj_t *parent) {
+    const lv_font_t *font = lv_obj_get_style_text_font(parent, LV_PART_MAIN);
+
+    if (scroll_timer == NULL) {
+        int ret = zmk_dongle_display_layer_names_init(
+            &layer_names, font, lv_obj_get_style_text_letter_space(parent, LV_PART_MAIN),
+            CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_WIDTH, "%i");
+        if (ret < 0) {
+            return NULL;
+        }
+
+        // Same gap between the end and the next start as a scrolling label
+        scroll_gap = 3 * lv_font_get_glyph_width(font, ' ', ' ');
+        scroll_timer = lv_timer_create(layer_status_scroll_timer_cb,
+                                       CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_STEP_MS, NULL);
+        lv_timer_pause(scroll_timer);
+    }
+
+    lv_obj_t *obj = lv_obj_create(parent);
+    lv_obj_set_size(obj, CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_WIDTH,
+                    lv_font_get_line_height(font));
+    lv_obj_add_event_cb(obj, layer_status_draw_cb, LV_EVENT_DRAW_MAIN, NULL);
+    return obj;
+}
+#endif
+
 static void set_layer_symbol(lv_obj_t *label, struct layer_status_state state) {
     if (state.label == NULL) {
         char text[7] = {};
@@ -40,6 +220,13 @@ static void set_layer_symbol(lv_obj_t *label, struct layer_status_state state) {
 }
 
 static void layer_status_update_cb(struct layer_status_state state) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_STRIP)
+    if (scroll_timer != NULL) {
+        layer_status_scroll_update(state);
+        return;
+    }
+#endif
+
     struct zmk_widget_layer_status *widget;
     SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_layer_symbol(widget->obj, state); }
 }
@@ -48,31 +235,47 @@ static struct layer_status_state layer_status_get_state(const zmk_event_t *eh) {
     uint8_t index = zmk_keymap_highest_layer_active();
     return (struct layer_status_state) {
         .index = index,
-        .label = zmk_keymap_layer_name(index)
+        .label = zmk_keymap_layer_name(index),
+        .active = zmk_activity_get_state() == ZMK_ACTIVITY_ACTIVE,
     };
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_layer_status, struct layer_status_state, layer_status_update_cb,
-                            layer_status_get_state)
+static bool layer_status_state_eq(const struct layer_status_state *a,
+                                  const struct layer_status_state *b) {
+    return a->index == b->index && a->label == b->label && a->active == b->active;
+}
+
+DONGLE_DISPLAY_WIDGET_LISTENER_DIFFED(widget_layer_status, struct layer_status_state,
+                                      layer_status_update_cb, layer_status_get_state,
+                                      layer_status_state_eq)
 
 ZMK_SUBSCRIPTION(widget_layer_status, zmk_layer_state_changed);
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_STRIP)
+ZMK_SUBSCRIPTION(widget_layer_status, zmk_activity_state_changed);
+#endif
 
 int zmk_widget_layer_status_init(struct zmk_widget_layer_status *widget, lv_obj_t *parent) {
-    widget->obj = lv_label_create(parent);
-    lv_obj_set_width(widget->obj, CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_WIDTH);
-    lv_label_set_long_mode(widget->obj, LV_LABEL_LONG_SCROLL_CIRCULAR);
+    widget->obj = NULL;
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_STRIP)
+    widget->obj = layer_status_create_strip(parent);
+#endif
 
-    // Set text alignment based on config
-    if (strcmp(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_TEXT_ALIGN, "right") == 0) {
-        lv_obj_set_style_text_align(widget->obj, LV_TEXT_ALIGN_RIGHT, 0);
-    } else if (strcmp(CONFIG_ZMK_DONGLE_DISPLAY_LAYER_TEXT_ALIGN, "center") == 0) {
-        lv_obj_set_style_text_align(widget->obj, LV_TEXT_ALIGN_CENTER, 0);
-    } else {
-        lv_obj_set_style_text_align(widget->obj, LV_TEXT_ALIGN_LEFT, 0);
+    // Without the strip, the label scrolls through an LVGL animation
+    if (widget->obj == NULL) {
+        widget->obj = lv_label_create(parent);
+        lv_obj_set_width(widget->obj, CONFIG_ZMK_DONGLE_DISPLAY_LAYER_NAME_SCROLL_WIDTH);
+        lv_label_set_long_mode(widget->obj, LV_LABEL_LONG_SCROLL_CIRCULAR);
+        lv_obj_set_style_text_align(widget->obj, layer_status_align(), 0);
     }
 
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    lv_obj_add_event_cb(widget->obj, layer_status_draw_begin_cb, LV_EVENT_DRAW_MAIN_BEGIN, NULL);
+    lv_obj_add_event_cb(widget->obj, layer_status_draw_end_cb, LV_EVENT_DRAW_MAIN_END, NULL);
+#endif
+
     sys_slist_append(&widgets, &widget->node);
 
+    widget_layer_status_watch(widget->obj);
     widget_layer_status_init();
     return 0;
 }
@@ -15,4 +15,9 @@ struct zmk_widget_layer_status {
 };
 
 int zmk_widget_layer_status_init(struct zmk_widget_layer_status *widget, lv_obj_t *parent);
-lv_obj_t *zmk_widget_layer_status_obj(struct zmk_widget_layer_status *widget);
\ No newline at end of file
+lv_obj_t *zmk_widget_layer_status_obj(struct zmk_widget_layer_status *widget);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+// Draw calls of the widget and the time they took since the last call
+void zmk_widget_layer_status_take_draw_stats(uint32_t *count, uint32_t *us);
+#endif
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/display.h>
+
+#include "listener_latency.h"
+
+// Refreshes without the widget that end the wait for its pixels. An animation
+// may only start drawing on the refresh after the apply, and an overshoot may
+// hold a position for a frame.
+#define QUIET_REFRESHES 2
+
+// Listeners the reports cover, more than the status screen has
+#define REPORT_LISTENERS 12
+
+static const char *const stage_names[ZMK_DONGLE_DISPLAY_LATENCY_STAGES] = {
+    [ZMK_DONGLE_DISPLAY_LATENCY_QUEUED] = "queued",
+    [ZMK_DONGLE_DISPLAY_LATENCY_DRAWN] = "drawn",
+    [ZMK_DONGLE_DISPLAY_LATENCY_SETTLED] = "settled",
+};
+
+static sys_slist_t latencies = SYS_SLIST_STATIC_INIT(&latencies);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+static zmk_dongle_display_latency_drawn_cb_t drawn_cb;
+
+void zmk_dongle_display_latency_set_drawn_cb(zmk_dongle_display_latency_drawn_cb_t cb) {
+    drawn_cb = cb;
+}
+#endif
+
+// Histograms taken from the listeners, built on the display thread
+static struct latency_report {
+    const char *name;
+    struct zmk_dongle_display_latency_hist stages[ZMK_DONGLE_DISPLAY_LATENCY_STAGES];
+} report[REPORT_LISTENERS];
+static size_t report_count;
+
+static void hist_add(struct zmk_dongle_display_latency_hist *hist, uint32_t cycles) {
+    uint32_t us = k_cyc_to_us_floor32(cycles);
+    uint8_t bucket = us ? MIN(32 - __builtin_clz(us), ZMK_DONGLE_DISPLAY_LATENCY_BUCKETS - 1) : 0;
+
+    hist->buckets[bucket]++;
+    hist->count++;
+    hist->sum += us;
+    hist->max = MAX(hist->max, us);
+}
+
+void zmk_dongle_display_latency_register(struct zmk_dongle_display_latency *latency,
+                                         const char *name) {
+    latency->name = name;
+    sys_slist_append(&latencies, &latency->node);
+}
+
+bool zmk_dongle_display_latency_apply(struct zmk_dongle_display_latency *latency,
+                                      bool (*apply)(void)) {
+    // Cleared first, so an event stored meanwhile is stamped for the next apply
+    uint32_t entered = atomic_clear(&latency->entered);
+    uint32_t start = k_cycle_get_32();
+    bool changed = apply();
+
+    // The initial state and states the widget skipped put nothing on the panel
+    if (entered == 0 || !changed) {
+        return changed;
+    }
+
+    hist_add(&latency->stages[ZMK_DONGLE_DISPLAY_LATENCY_QUEUED], start - entered);
+
+    if (latency->tracked != 0) {
+        // The earlier state was not drawn yet, so both reach the panel together
+        if (!latency->drawn) {
+            return changed;
+        }
+        // This state cuts the animations of the earlier one short
+        hist_add(&latency->stages[ZMK_DONGLE_DISPLAY_LATENCY_SETTLED],
+                 latency->last_flushed - latency->tracked);
+    }
+
+    latency->tracked = entered;
+    latency->refreshes = 0;
+    latency->drawn = false;
+    return changed;
+}
+
+void zmk_dongle_display_latency_refresh_begin(const lv_disp_t *disp) {
+    struct zmk_dongle_display_latency *latency;
+    SYS_SLIST_FOR_EACH_CONTAINER(&latencies, latency, node) {
+        if (latency->tracked == 0) {
+            continue;
+        }
+
+        latency->touched = latency->obj == NULL;
+        if (latency->touched) {
+            continue;
+        }
+
+        // The areas before joining, so other widgets' redraws do not count
+        lv_area_t coords, common;
+        lv_obj_get_coords(latency->obj, &coords);
+        for (uint16_t i = 0; i < disp->inv_p && !latency->touched; i++) {
+            latency->touched = !disp->inv_area_joined[i] &&
+                               _lv_area_intersect(&common, &disp->inv_areas[i], &coords);
+        }
+    }
+}
+
+void zmk_dongle_display_latency_refresh_end(bool flushed) {
+    uint32_t now = k_cycle_get_32();
+
+    struct zmk_dongle_display_latency *latency;
+    SYS_SLIST_FOR_EACH_CONTAINER(&latencies, latency, node) {
+        if (latency->tracked == 0) {
+            continue;
+        }
+
+        if (latency->touched && flushed) {
+            if (!latency->drawn) {
+                hist_add(&latency->stages[ZMK_DONGLE_DISPLAY_LATENCY_DRAWN],
+                         now - latency->tracked);
+                latency->drawn = true;
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+                if (drawn_cb != NULL) {
+                    drawn_cb(latency->name);
+                }
+#endif
+            }
+            latency->last_flushed = now;
+            latency->refreshes = 0;
+            continue;
+        }
+
+        if (++latency->refreshes < QUIET_REFRESHES) {
+            continue;
+        }
+
+        // A state no refresh redrew changed nothing the panel shows
+        if (latency->drawn) {
+            hist_add(&latency->stages[ZMK_DONGLE_DISPLAY_LATENCY_SETTLED],
+                     latency->last_flushed - latency->tracked);
+        }
+        latency->tracked = 0;
+    }
+}
+
+// Runs on the display thread, so the histograms are not written meanwhile
+static void build_report(void) {
+    report_count = 0;
+
+    struct zmk_dongle_display_latency *latency;
+    SYS_SLIST_FOR_EACH_CONTAINER(&latencies, latency, node) {
+        if (report_count < ARRAY_SIZE(report)) {
+            report[report_count].name = latency->name;
+            memcpy(report[report_count].stages, latency->stages, sizeof(latency->stages));
+            report_count++;
+        }
+        memset(latency->stages, 0, sizeof(latency->stages));
+    }
+}
+
+// Formats one histogram as "stage count avg/max | bucket:count ..." for non-empty buckets
+static void format_hist(char *buf, size_t len, const char *name,
+                        const struct zmk_dongle_display_latency_hist *hist) {
+    int pos = snprintf(buf, len, "  %-8s n %4u avg %6u max %6u us |", name, hist->count,
+                       hist->count ? hist->sum / hist->count : 0, hist->max);
+
+    for (int i = 0; i < ZMK_DONGLE_DISPLAY_LATENCY_BUCKETS && pos > 0 && pos < len; i++) {
+        if (hist->buckets[i] == 0) {
+            continue;
+        }
+        pos += snprintf(buf + pos, len - pos, " %u+:%u", i ? 1U << (i - 1) : 0, hist->buckets[i]);
+    }
+}
+
+static void latency_log_work_cb(struct k_work *work) {
+    char line[192];
+
+    build_report();
+
+    LOG_INF("Event to panel latency since the last report:");
+    for (size_t i = 0; i < report_count; i++) {
+        LOG_INF("%s", report[i].name);
+        for (int stage = 0; stage < ZMK_DONGLE_DISPLAY_LATENCY_STAGES; stage++) {
+            format_hist(line, sizeof(line), stage_names[stage], &report[i].stages[stage]);
+            LOG_INF("%s", line);
+        }
+    }
+}
+
+static K_WORK_DEFINE(latency_log_work, latency_log_work_cb);
+
+void zmk_dongle_display_latency_log(void) {
+    k_work_submit_to_queue(zmk_display_work_q(), &latency_log_work);
+}
+
+#if IS_ENABLED(CONFIG_SHELL)
+static K_SEM_DEFINE(latency_shell_sem, 0, 1);
+
+static void latency_shell_work_cb(struct k_work *work) {
+    build_report();
+    k_sem_give(&latency_shell_sem);
+}
+
+static K_WORK_DEFINE(latency_shell_work, latency_shell_work_cb);
+
+static int cmd_latency(const struct shell *sh, size_t argc, char **argv) {
+    char line[192];
+
+    k_sem_reset(&latency_shell_sem);
+    k_work_submit_to_queue(zmk_display_work_q(), &latency_shell_work);
+    if (k_sem_take(&latency_shell_sem, K_SECONDS(1)) != 0) {
+        shell_error(sh, "Display thread did not respond");
+        return -ETIMEDOUT;
+    }
+
+    shell_print(sh, "Event to panel latency since the last report:");
+    for (size_t i = 0; i < report_count; i++) {
+        shell_print(sh, "%s", report[i].name);
+        for (int stage = 0; stage < ZMK_DONGLE_DISPLAY_LATENCY_STAGES; stage++) {
+            format_hist(line, sizeof(line), stage_names[stage], &report[i].stages[stage]);
+            shell_print(sh, "%s", line);
+        }
+    }
+    return 0;
+}
+
+SHELL_SUBCMD_ADD((dongle_display), latency, NULL, "Event to panel latency histograms per widget",
+                 cmd_latency, 1, 0);
+#endif
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+// Power-of-two buckets of microseconds; the last one takes everything from 2^18 up
+#define ZMK_DONGLE_DISPLAY_LATENCY_BUCKETS 20
+
+enum zmk_dongle_display_latency_stage {
+    ZMK_DONGLE_DISPLAY_LATENCY_QUEUED,  // until the display thread applied the state
+    ZMK_DONGLE_DISPLAY_LATENCY_DRAWN,   // until the first refresh redrawing the widget was flushed
+    ZMK_DONGLE_DISPLAY_LATENCY_SETTLED, // until the last one, after its animations ended
+    ZMK_DONGLE_DISPLAY_LATENCY_STAGES,
+};
+
+struct zmk_dongle_display_latency_hist {
+    uint16_t buckets[ZMK_DONGLE_DISPLAY_LATENCY_BUCKETS];
+    uint32_t count;
+    uint32_t sum;
+    uint32_t max;
+};
+
+// Time from an event entering a widget listener until the widget's pixels
+// reached the panel, kept per listener
+struct zmk_dongle_display_latency {
+    sys_snode_t node;
+    const char *name;
+    lv_obj_t *obj;    // whose redraws count, NULL for any refresh that flushed
+    atomic_t entered; // cycle count of the oldest event not applied yet, 0 if none
+    // The applied state whose pixels are awaited, only used on the display thread
+    uint32_t tracked;
+    uint32_t last_flushed;
+    uint8_t refreshes;
+    bool drawn;
+    bool touched;
+    struct zmk_dongle_display_latency_hist stages[ZMK_DONGLE_DISPLAY_LATENCY_STAGES];
+};
+
+void zmk_dongle_display_latency_register(struct zmk_dongle_display_latency *latency,
+                                         const char *name);
+
+// Runs apply on the display thread and starts waiting for the pixels of the
+// state it applied. Returns what apply returned.
+bool zmk_dongle_display_latency_apply(struct zmk_dongle_display_latency *latency,
+                                      bool (*apply)(void));
+
+// Called by the refresh probe around every refresh of the default display
+void zmk_dongle_display_latency_refresh_begin(const lv_disp_t *disp);
+void zmk_dongle_display_latency_refresh_end(bool flushed);
+
+// Logs the histograms of every listener and starts them over
+void zmk_dongle_display_latency_log(void);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+typedef void (*zmk_dongle_display_latency_drawn_cb_t)(const char *name);
+
+// Called on the display thread once the first refresh redrawing a listener's
+// widget after an applied state reached the panel
+void zmk_dongle_display_latency_set_drawn_cb(zmk_dongle_display_latency_drawn_cb_t cb);
+#endif
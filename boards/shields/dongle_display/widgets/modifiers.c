@@ -17,6 +17,7 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <dt-bindings/zmk/modifiers.h>
 
 #include "modifiers.h"
+#include "widget_listener.h"
 
 struct modifiers_state {    
     uint8_t modifiers;
@@ -130,8 +131,16 @@ static struct modifiers_state modifiers_get_state(const zmk_event_t *eh) {
     };
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_modifiers, struct modifiers_state,
-                            modifiers_update_cb, modifiers_get_state)
+// Most keycode events are plain keys that leave the modifiers untouched
+static atomic_t published_modifiers = ATOMIC_INIT(-1);
+
+static bool modifiers_changed(const struct modifiers_state *state) {
+    return atomic_set(&published_modifiers, state->modifiers) != state->modifiers;
+}
+
+DONGLE_DISPLAY_WIDGET_LISTENER_FILTERED(widget_modifiers, struct modifiers_state,
+                                        modifiers_update_cb, modifiers_get_state,
+                                        modifiers_changed)
 
 ZMK_SUBSCRIPTION(widget_modifiers, zmk_keycode_state_changed);
 
@@ -159,6 +168,7 @@ int zmk_widget_modifiers_init(struct zmk_widget_modifiers *widget, lv_obj_t *par
 
     sys_slist_append(&widgets, &widget->node);
 
+    widget_modifiers_watch(widget->obj);
     widget_modifiers_init();
 
     return 0;
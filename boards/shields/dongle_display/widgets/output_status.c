@@ -17,6 +17,7 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 #include <zmk/endpoints.h>
 
 #include "output_status.h"
+#include "widget_listener.h"
 #if IS_ENABLED(CONFIG_ZMK_BLE)
 #  include <zmk/events/ble_active_profile_changed.h>
 #  include <zmk/ble.h>
@@ -42,15 +43,6 @@ const lv_img_dsc_t *sym_num[] = {
     &sym_5,
 };
 
-enum output_symbol {
-    output_symbol_usb,
-    output_symbol_usb_hid_status,
-    output_symbol_bt,
-    output_symbol_bt_number,
-    output_symbol_bt_status,
-    output_symbol_selection_line
-};
-
 enum selection_line_state {
     selection_line_state_usb,
     selection_line_state_bt
@@ -85,6 +77,15 @@ static struct output_status_state get_state(const zmk_event_t *_eh) {
     return st;
 }
 
+static bool output_status_state_eq(const struct output_status_state *a,
+                                   const struct output_status_state *b) {
+    return a->selected_endpoint.transport == b->selected_endpoint.transport &&
+           a->active_profile_index == b->active_profile_index &&
+           a->active_profile_connected == b->active_profile_connected &&
+           a->active_profile_bonded == b->active_profile_bonded &&
+           a->usb_is_hid_ready == b->usb_is_hid_ready;
+}
+
 static void anim_x_cb(void * var, int32_t v) {
     lv_obj_set_x(var, v);
 }
@@ -115,13 +116,18 @@ static void change_size_object(void *obj, int32_t from, int32_t to) {
     lv_anim_start(&a);
 }
 
-static void set_status_symbol(lv_obj_t *widget, struct output_status_state state) {
-    lv_obj_t *usb = lv_obj_get_child(widget, output_symbol_usb);
-    lv_obj_t *usb_hid_status = lv_obj_get_child(widget, output_symbol_usb_hid_status);
-    lv_obj_t *bt = lv_obj_get_child(widget, output_symbol_bt);
-    lv_obj_t *bt_number = lv_obj_get_child(widget, output_symbol_bt_number);
-    lv_obj_t *bt_status = lv_obj_get_child(widget, output_symbol_bt_status);
-    lv_obj_t *selection_line = lv_obj_get_child(widget, output_symbol_selection_line);
+// Setting the source invalidates the image even if it is the same
+static void set_img_src(lv_obj_t *img, const lv_img_dsc_t *src) {
+    if (lv_img_get_src(img) != src) {
+        lv_img_set_src(img, src);
+    }
+}
+
+static void set_status_symbol(struct zmk_widget_output_status *widget,
+                              struct output_status_state state) {
+    lv_obj_t *usb = widget->usb;
+    lv_obj_t *bt = widget->bt;
+    lv_obj_t *selection_line = widget->selection_line;
 
     switch (state.selected_endpoint.transport) {
     case ZMK_TRANSPORT_USB:
@@ -141,35 +147,35 @@ static void set_status_symbol(lv_obj_t *widget, struct output_status_state state
     }
 
     if (state.usb_is_hid_ready) {
-        lv_img_set_src(usb_hid_status, &sym_ok);
+        set_img_src(widget->usb_hid_status, &sym_ok);
     } else {
-        lv_img_set_src(usb_hid_status, &sym_nok);
+        set_img_src(widget->usb_hid_status, &sym_nok);
     }
 
     if (state.active_profile_index < (sizeof(sym_num) / sizeof(lv_img_dsc_t *))) {
-        lv_img_set_src(bt_number, sym_num[state.active_profile_index]);
+        set_img_src(widget->bt_number, sym_num[state.active_profile_index]);
     } else {
-        lv_img_set_src(bt_number, &sym_nok);
+        set_img_src(widget->bt_number, &sym_nok);
     }
     
     if (state.active_profile_bonded) {
         if (state.active_profile_connected) {
-            lv_img_set_src(bt_status, &sym_ok);
+            set_img_src(widget->bt_status, &sym_ok);
         } else {
-            lv_img_set_src(bt_status, &sym_nok);
+            set_img_src(widget->bt_status, &sym_nok);
         }
     } else {
-        lv_img_set_src(bt_status, &sym_open);
+        set_img_src(widget->bt_status, &sym_open);
     }
 }
 
 static void output_status_update_cb(struct output_status_state state) {
     struct zmk_widget_output_status *widget;
-    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_status_symbol(widget->obj, state); }
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_status_symbol(widget, state); }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_output_status, struct output_status_state,
-                            output_status_update_cb, get_state)
+DONGLE_DISPLAY_WIDGET_LISTENER_DIFFED(widget_output_status, struct output_status_state,
+                                      output_status_update_cb, get_state, output_status_state_eq)
 ZMK_SUBSCRIPTION(widget_output_status, zmk_endpoint_changed);
 #if IS_ENABLED(CONFIG_ZMK_BLE)
 ZMK_SUBSCRIPTION(widget_output_status, zmk_ble_active_profile_changed);
@@ -181,6 +187,7 @@ int zmk_widget_output_status_init(struct zmk_widget_output_status *widget, lv_ob
 
     lv_obj_set_size(widget->obj, LV_SIZE_CONTENT, LV_SIZE_CONTENT);
 
+    // Kept in the widget, so updates need no child lookups
     lv_obj_t *usb = lv_img_create(widget->obj);
     lv_obj_align(usb, LV_ALIGN_TOP_LEFT, 1, 4);
     lv_img_set_src(usb, &sym_usb);
@@ -207,9 +214,17 @@ int zmk_widget_output_status_init(struct zmk_widget_output_status *widget, lv_ob
     lv_line_set_points(selection_line, selection_line_points, 2);
     lv_obj_add_style(selection_line, &style_line, 0);
     lv_obj_align_to(selection_line, usb, LV_ALIGN_OUT_TOP_LEFT, 3, -2);
- 
+
+    widget->usb = usb;
+    widget->usb_hid_status = usb_hid_status;
+    widget->bt = bt;
+    widget->bt_number = bt_number;
+    widget->bt_status = bt_status;
+    widget->selection_line = selection_line;
+
     sys_slist_append(&widgets, &widget->node);
 
+    widget_output_status_watch(widget->obj);
     widget_output_status_init();
     return 0;
 }
@@ -4,7 +4,9 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include "battery_history.h"
 #include "split_battery_bar.h"
+#include "widget_listener.h"
 
 #include <zephyr/bluetooth/services/bas.h>
 
@@ -23,108 +25,149 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 
+#define SLOT_WIDTH 38
+#define BAR_WIDTH 28
+#define BAR_HEIGHT 6
+#define BAR_Y 10
+
 struct peripheral_battery {
-    lv_obj_t *label;
-    lv_obj_t *bar;
-    lv_obj_t *bar_bg;
+    uint16_t estimate;
+    uint8_t level;
+    bool connected;
 };
 
-// Static allocation for peripheral battery objects
-static struct peripheral_battery peripherals[ZMK_SPLIT_BLE_PERIPHERAL_COUNT];
-
 static struct battery_state {
-    uint8_t levels[ZMK_SPLIT_BLE_PERIPHERAL_COUNT];
-    bool connected[ZMK_SPLIT_BLE_PERIPHERAL_COUNT];
+    struct peripheral_battery peripherals[ZMK_SPLIT_BLE_PERIPHERAL_COUNT];
 } current_state = {0};
 
-static void set_battery_bar_value(uint8_t source, uint8_t level) {
-    if (source >= ZMK_SPLIT_BLE_PERIPHERAL_COUNT) {
-        return;
-    }
+// What the draw callback renders, only touched on the display thread
+static struct battery_state drawn_state;
 
-    char text[8];
-    snprintf(text, sizeof(text), "%u%%", level);
-    lv_label_set_text(peripherals[source].label, text);
-    
-    // Manually draw battery level as a filled rectangle
-    lv_obj_t *bar = peripherals[source].bar;
-    int32_t bar_width = (level * 28) / 100; // 28 is the total width
-    lv_obj_set_width(bar, bar_width > 0 ? bar_width : 1);
+static void slot_area(const lv_area_t *coords, uint8_t source, lv_area_t *area) {
+    area->x1 = coords->x1 + source * SLOT_WIDTH;
+    area->y1 = coords->y1;
+    area->x2 = MIN(area->x1 + SLOT_WIDTH - 1, coords->x2);
+    area->y2 = coords->y2;
 }
 
-static void set_battery_connection(uint8_t source, bool connected) {
-    if (source >= ZMK_SPLIT_BLE_PERIPHERAL_COUNT) {
-        return;
-    }
+static void battery_bar_draw_cb(lv_event_t *e) {
+    lv_obj_t *obj = lv_event_get_target(e);
+    lv_draw_ctx_t *draw_ctx = lv_event_get_draw_ctx(e);
+
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
 
-    if (connected) {
-        lv_obj_clear_flag(peripherals[source].label, LV_OBJ_FLAG_HIDDEN);
-        lv_obj_clear_flag(peripherals[source].bar_bg, LV_OBJ_FLAG_HIDDEN);
-        lv_obj_clear_flag(peripherals[source].bar, LV_OBJ_FLAG_HIDDEN);
-    } else {
-        lv_label_set_text(peripherals[source].label, "--");
-        lv_obj_add_flag(peripherals[source].bar_bg, LV_OBJ_FLAG_HIDDEN);
-        lv_obj_add_flag(peripherals[source].bar, LV_OBJ_FLAG_HIDDEN);
+    lv_draw_label_dsc_t label_dsc;
+    lv_draw_label_dsc_init(&label_dsc);
+    lv_obj_init_draw_label_dsc(obj, LV_PART_MAIN, &label_dsc);
+    label_dsc.font = &lv_font_unscii_8;
+
+    lv_draw_rect_dsc_t outline_dsc;
+    lv_draw_rect_dsc_init(&outline_dsc);
+    outline_dsc.bg_color = lv_color_black();
+    outline_dsc.bg_opa = LV_OPA_COVER;
+    outline_dsc.border_width = 1;
+    outline_dsc.border_color = lv_color_white();
+    outline_dsc.border_opa = LV_OPA_COVER;
+
+    lv_draw_rect_dsc_t fill_dsc;
+    lv_draw_rect_dsc_init(&fill_dsc);
+    fill_dsc.bg_color = lv_color_white();
+    fill_dsc.bg_opa = LV_OPA_COVER;
+
+    for (int i = 0; i < ZMK_SPLIT_BLE_PERIPHERAL_COUNT; i++) {
+        const struct peripheral_battery *peripheral = &drawn_state.peripherals[i];
+        lv_area_t slot, clipped;
+
+        slot_area(&coords, i, &slot);
+        // Only the slots of peripherals that changed are being redrawn
+        if (!_lv_area_intersect(&clipped, &slot, draw_ctx->clip_area)) {
+            continue;
+        }
+
+        // Percentage (small text, with % symbol), or the time left once known,
+        // as the bar below already shows the level
+        char text[8];
+        if (peripheral->connected &&
+            peripheral->estimate != ZMK_DONGLE_DISPLAY_BATTERY_NO_ESTIMATE) {
+            zmk_dongle_display_battery_format_estimate(text, sizeof(text), peripheral->estimate);
+        } else if (peripheral->connected) {
+            snprintf(text, sizeof(text), "%u%%", peripheral->level);
+        } else {
+            strcpy(text, "--");
+        }
+        lv_area_t label_area = {slot.x1 + 2, slot.y1, slot.x2, slot.y1 + BAR_Y - 1};
+        lv_draw_label(draw_ctx, &label_dsc, &label_area, text, NULL);
+
+        if (!peripheral->connected) {
+            continue;
+        }
+
+        lv_area_t bar_area = {slot.x1, slot.y1 + BAR_Y, slot.x1 + BAR_WIDTH - 1,
+                              slot.y1 + BAR_Y + BAR_HEIGHT - 1};
+        lv_draw_rect(draw_ctx, &outline_dsc, &bar_area);
+
+        // Filled part inside the outline, at least one pixel wide
+        int32_t fill_width = MAX((peripheral->level * (BAR_WIDTH - 2)) / 100, 1);
+        lv_area_t fill_area = {bar_area.x1 + 1, bar_area.y1 + 1, bar_area.x1 + fill_width,
+                               bar_area.y2 - 1};
+        lv_draw_rect(draw_ctx, &fill_dsc, &fill_area);
     }
 }
 
-static void battery_bar_update_cb(struct battery_state state) {
+static void set_battery_bar(lv_obj_t *obj, const struct battery_state *state) {
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
+
     for (int i = 0; i < ZMK_SPLIT_BLE_PERIPHERAL_COUNT; i++) {
-        set_battery_bar_value(i, state.levels[i]);
-        set_battery_connection(i, state.connected[i]);
+        if (memcmp(&state->peripherals[i], &drawn_state.peripherals[i],
+                   sizeof(struct peripheral_battery)) == 0) {
+            continue;
+        }
+
+        lv_area_t slot;
+        slot_area(&coords, i, &slot);
+        lv_obj_invalidate_area(obj, &slot);
     }
 }
 
+static void battery_bar_update_cb(struct battery_state state) {
+    struct zmk_widget_split_battery_bar *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { set_battery_bar(widget->obj, &state); }
+    drawn_state = state;
+}
+
 static struct battery_state battery_bar_get_state(const zmk_event_t *eh) {
     const struct zmk_peripheral_battery_state_changed *ev = as_zmk_peripheral_battery_state_changed(eh);
     if (ev != NULL && ev->source < ZMK_SPLIT_BLE_PERIPHERAL_COUNT) {
-        current_state.levels[ev->source] = ev->state_of_charge;
-        current_state.connected[ev->source] = true;
+        current_state.peripherals[ev->source].level = ev->state_of_charge;
+        current_state.peripherals[ev->source].connected = true;
+        current_state.peripherals[ev->source].estimate = zmk_dongle_display_battery_estimate(
+            ZMK_DONGLE_DISPLAY_BATTERY_SOURCE_PERIPHERAL(ev->source), ev->state_of_charge);
     }
     return current_state;
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_split_battery_bar, struct battery_state,
-                            battery_bar_update_cb, battery_bar_get_state)
+// The estimate comes first, so the state has no padding to compare
+static bool battery_bar_state_eq(const struct battery_state *a, const struct battery_state *b) {
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+DONGLE_DISPLAY_WIDGET_LISTENER_DIFFED(widget_split_battery_bar, struct battery_state,
+                                      battery_bar_update_cb, battery_bar_get_state,
+                                      battery_bar_state_eq)
 
 ZMK_SUBSCRIPTION(widget_split_battery_bar, zmk_peripheral_battery_state_changed);
 
 int zmk_widget_split_battery_bar_init(struct zmk_widget_split_battery_bar *widget, lv_obj_t *parent) {
+    // One object draws every peripheral from the state array
     widget->obj = lv_obj_create(parent);
     lv_obj_set_size(widget->obj, 78, 20);
-
-    for (int i = 0; i < ZMK_SPLIT_BLE_PERIPHERAL_COUNT; i++) {
-        // Label showing percentage (small text, with % symbol)
-        lv_obj_t *label = lv_label_create(widget->obj);
-        lv_label_set_text(label, "--");
-        lv_obj_set_pos(label, i * 38 + 2, 0);
-        lv_obj_set_style_text_font(label, &lv_font_unscii_8, 0);
-        
-        // Simple bar as a filled rectangle (no lv_bar widget)
-        lv_obj_t *bar_bg = lv_obj_create(widget->obj);
-        lv_obj_set_size(bar_bg, 28, 6);
-        lv_obj_set_pos(bar_bg, i * 38, 10);
-        lv_obj_set_style_bg_color(bar_bg, lv_color_black(), 0);
-        lv_obj_set_style_border_width(bar_bg, 1, 0);
-        lv_obj_set_style_border_color(bar_bg, lv_color_white(), 0);
-        
-        // Bar indicator (filled part)
-        lv_obj_t *bar = lv_obj_create(bar_bg);
-        lv_obj_set_size(bar, 1, 6);
-        lv_obj_set_style_bg_color(bar, lv_color_white(), 0);
-        lv_obj_set_style_border_width(bar, 0, 0);
-        lv_obj_align(bar, LV_ALIGN_LEFT_MID, 0, 0);
-
-        peripherals[i].label = label;
-        peripherals[i].bar = bar;
-        peripherals[i].bar_bg = bar_bg;
-
-        current_state.levels[i] = 0;
-        current_state.connected[i] = false;
-    }
+    lv_obj_add_event_cb(widget->obj, battery_bar_draw_cb, LV_EVENT_DRAW_MAIN, NULL);
 
     sys_slist_append(&widgets, &widget->node);
 
+    widget_split_battery_bar_watch(widget->obj);
     widget_split_battery_bar_init();
 
     return 0;
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include "widget_listener.h"
+
+static sys_slist_t listeners = SYS_SLIST_STATIC_INIT(&listeners);
+
+static void listener_apply(struct zmk_dongle_display_listener *listener) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    bool changed = zmk_dongle_display_latency_apply(&listener->latency, listener->apply);
+#else
+    bool changed = listener->apply();
+#endif
+    atomic_inc(changed ? &listener->applied : &listener->unchanged);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_COALESCE_UPDATES)
+static lv_timer_t *frame_timer;
+
+static void listener_frame_cb(lv_timer_t *timer) {
+    struct zmk_dongle_display_listener *listener;
+    SYS_SLIST_FOR_EACH_CONTAINER(&listeners, listener, node) {
+        // Clear before applying, so a state stored meanwhile is applied next frame
+        if (atomic_cas(&listener->pending, 1, 0)) {
+            listener_apply(listener);
+        }
+    }
+}
+#else
+static void listener_work_cb(struct k_work *work) {
+    struct zmk_dongle_display_listener *listener =
+        CONTAINER_OF(work, struct zmk_dongle_display_listener, work);
+
+    // Cleared before applying, so a state stored meanwhile submits the work again
+    atomic_clear(&listener->pending);
+    listener_apply(listener);
+}
+#endif
+
+void zmk_dongle_display_listener_register(struct zmk_dongle_display_listener *listener) {
+    // Every widget instance initializes the listener, the first one registers it
+    if (atomic_get(&listener->registered)) {
+        return;
+    }
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_COALESCE_UPDATES)
+    // Widgets are initialized on the display thread, so LVGL may be used here
+    if (frame_timer == NULL) {
+        lv_disp_t *disp = lv_disp_get_default();
+        frame_timer = lv_timer_create(listener_frame_cb, disp->refr_timer->period, NULL);
+    }
+#else
+    k_work_init(&listener->work, listener_work_cb);
+#endif
+
+    sys_slist_append(&listeners, &listener->node);
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    zmk_dongle_display_latency_register(&listener->latency, listener->name);
+#endif
+
+    // Last, so events only submit the work once it is set up
+    atomic_set(&listener->registered, 1);
+}
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+void zmk_dongle_display_listener_watch(struct zmk_dongle_display_listener *listener,
+                                       lv_obj_t *obj) {
+    // Every widget instance gets the same states, the first one stands for all
+    if (listener->latency.obj == NULL) {
+        listener->latency.obj = obj;
+    }
+}
+#endif
+
+void zmk_dongle_display_listener_log_stats(void) {
+    struct zmk_dongle_display_listener *listener;
+    SYS_SLIST_FOR_EACH_CONTAINER(&listeners, listener, node) {
+        uint32_t published = atomic_get(&listener->published);
+        uint32_t applied = atomic_get(&listener->applied);
+        uint32_t unchanged = atomic_get(&listener->unchanged);
+
+        LOG_INF("%s: %u dropped, %u states, %u merged, %u unchanged, %u applied", listener->name,
+                (uint32_t)atomic_get(&listener->filtered), published,
+                published - applied - unchanged, unchanged, applied);
+    }
+}
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+void zmk_dongle_display_listener_take_store_stats(uint32_t *stores, uint32_t *cycles,
+                                                  uint32_t *retries) {
+    *stores = *cycles = *retries = 0;
+
+    struct zmk_dongle_display_listener *listener;
+    SYS_SLIST_FOR_EACH_CONTAINER(&listeners, listener, node) {
+        *stores += atomic_clear(&listener->stores);
+        *cycles += atomic_clear(&listener->store_cycles);
+        *retries += atomic_clear(&listener->retries);
+    }
+}
+
+// About the size of the larger widget states
+#define HANDOFF_STATE_SIZE 16
+// How long a widget update holds the state in ZMK's own listener
+#define HANDOFF_APPLY_US 100
+#define HANDOFF_FRAME_MS 33
+#define HANDOFF_STACK_SIZE 1024
+
+struct handoff_state {
+    uint8_t bytes[HANDOFF_STATE_SIZE];
+};
+
+static K_MUTEX_DEFINE(handoff_mutex);
+static struct handoff_state handoff_mutex_state;
+
+// Never registered, so its stores do not queue any work
+static struct zmk_dongle_display_listener handoff_listener;
+static struct handoff_state handoff_lockfree_states[ZMK_DONGLE_DISPLAY_LISTENER_SLOTS];
+
+static K_THREAD_STACK_DEFINE(handoff_stack, HANDOFF_STACK_SIZE);
+static struct k_thread handoff_thread;
+static atomic_t handoff_running;
+
+static uint32_t handoff_stores;
+static uint64_t handoff_mutex_cycles, handoff_lockfree_cycles;
+static uint32_t handoff_mutex_waits;
+
+static void handoff_thread_main(void *p1, void *p2, void *p3) {
+    struct handoff_state copy;
+
+    while (atomic_get(&handoff_running)) {
+        // Like ZMK_DISPLAY_WIDGET_LISTENER, which keeps the mutex while the
+        // widget is updated
+        k_mutex_lock(&handoff_mutex, K_FOREVER);
+        copy = handoff_mutex_state;
+        k_busy_wait(HANDOFF_APPLY_US);
+        k_mutex_unlock(&handoff_mutex);
+
+        zmk_dongle_display_listener_read_lockfree(&handoff_listener, &copy,
+                                                  handoff_lockfree_states, sizeof(copy));
+        k_busy_wait(HANDOFF_APPLY_US);
+
+        k_sleep(K_MSEC(HANDOFF_FRAME_MS));
+    }
+}
+
+void zmk_dongle_display_listener_handoff_start(void) {
+    handoff_stores = 0;
+    handoff_mutex_cycles = handoff_lockfree_cycles = 0;
+    handoff_mutex_waits = 0;
+    atomic_clear(&handoff_listener.retries);
+
+    // Below the event side, so stores preempt the reads as events would
+    atomic_set(&handoff_running, 1);
+    k_thread_create(&handoff_thread, handoff_stack, K_THREAD_STACK_SIZEOF(handoff_stack),
+                    handoff_thread_main, NULL, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0,
+                    K_NO_WAIT);
+}
+
+void zmk_dongle_display_listener_handoff_store(void) {
+    struct handoff_state value;
+    memset(&value, handoff_stores, sizeof(value));
+
+    uint32_t start = zmk_dongle_display_probe_cycles();
+    if (k_mutex_lock(&handoff_mutex, K_NO_WAIT) != 0) {
+        handoff_mutex_waits++;
+        k_mutex_lock(&handoff_mutex, K_FOREVER);
+    }
+    handoff_mutex_state = value;
+    k_mutex_unlock(&handoff_mutex);
+    handoff_mutex_cycles += zmk_dongle_display_probe_cycles() - start;
+
+    start = zmk_dongle_display_probe_cycles();
+    zmk_dongle_display_listener_write_lockfree(&handoff_listener, handoff_lockfree_states, &value,
+                                               sizeof(value));
+    handoff_lockfree_cycles += zmk_dongle_display_probe_cycles() - start;
+
+    handoff_stores++;
+}
+
+void zmk_dongle_display_listener_handoff_stop(void) {
+    atomic_clear(&handoff_running);
+    k_thread_join(&handoff_thread, K_FOREVER);
+
+    if (handoff_stores == 0) {
+        return;
+    }
+    LOG_INF("bench handoff of %u stores: %u ns per store with the mutex, %u of them waited, "
+            "%u ns per store lock-free, %u reads repeated",
+            handoff_stores,
+            (uint32_t)(zmk_dongle_display_probe_cycles_to_ns(handoff_mutex_cycles) /
+                       handoff_stores),
+            handoff_mutex_waits,
+            (uint32_t)(zmk_dongle_display_probe_cycles_to_ns(handoff_lockfree_cycles) /
+                       handoff_stores),
+            (uint32_t)atomic_get(&handoff_listener.retries));
+}
+#endif
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <string.h>
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include <zmk/display.h>
+#include <zmk/event_manager.h>
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+#include "../refresh_probe.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+#include "listener_latency.h"
+#endif
+
+// States a lock-free listener keeps: the newest, one the display thread may
+// still be copying and one for each of two events storing at the same time
+#define ZMK_DONGLE_DISPLAY_LISTENER_SLOTS 4
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LOCKFREE_UPDATES)
+#define ZMK_DONGLE_DISPLAY_LISTENER_STATES ZMK_DONGLE_DISPLAY_LISTENER_SLOTS
+#else
+#define ZMK_DONGLE_DISPLAY_LISTENER_STATES 1
+#endif
+
+struct zmk_dongle_display_listener {
+    sys_snode_t node;
+    const char *name;
+    bool (*apply)(void); // false if the state was the one applied last
+    struct k_work work;
+    atomic_t registered; // set once the widget is on a screen and work is set up
+    atomic_t pending;
+    atomic_t published; // states stored by the event side
+    atomic_t filtered;  // events dropped by the event side
+    atomic_t applied;   // states passed to the widget on the display thread
+    atomic_t unchanged; // states the display thread skipped as already applied
+    // Lock-free handoff: the slot of the newest state plus one, 0 before the
+    // first, and the stores, publication and reads using each slot
+    atomic_t latest;
+    atomic_t refs[ZMK_DONGLE_DISPLAY_LISTENER_SLOTS];
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    atomic_t store_cycles; // probe clock time the event side spent storing states
+    atomic_t stores;
+    atomic_t retries; // state reads the display thread repeated over a store
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    struct zmk_dongle_display_latency latency;
+#endif
+};
+
+void zmk_dongle_display_listener_register(struct zmk_dongle_display_listener *listener);
+void zmk_dongle_display_listener_log_stats(void);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+// States stored by all listeners since the last call, the probe clock cycles
+// the event side spent storing them and how often the display thread had to
+// read one again
+void zmk_dongle_display_listener_take_store_stats(uint32_t *stores, uint32_t *cycles,
+                                                  uint32_t *retries);
+
+// Starts a thread that reads two test states once per frame, one handed over
+// the way ZMK's own widget listener does, through a mutex held while the
+// state is applied, and one through the lock-free slots
+void zmk_dongle_display_listener_handoff_start(void);
+
+// Stores the next test state both ways, timing each, on the event side
+void zmk_dongle_display_listener_handoff_store(void);
+
+// Stops the reading thread and logs the time per store, the stores that
+// waited for the mutex and the reads that had to be repeated
+void zmk_dongle_display_listener_handoff_stop(void);
+#endif
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+// Only redraws of obj count as the widget's pixels reaching the panel
+void zmk_dongle_display_listener_watch(struct zmk_dongle_display_listener *listener,
+                                       lv_obj_t *obj);
+#else
+static inline void zmk_dongle_display_listener_watch(struct zmk_dongle_display_listener *listener,
+                                                     lv_obj_t *obj) {}
+#endif
+
+// Cycle count of an event entering a listener, 0 when latency is not measured
+static inline uint32_t zmk_dongle_display_listener_now(void) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    // 0 stands for no event, so the lowest bit is always set
+    return k_cycle_get_32() | 1;
+#else
+    return 0;
+#endif
+}
+
+static inline void zmk_dongle_display_listener_mark(struct zmk_dongle_display_listener *listener,
+                                                    uint32_t entered) {
+    // Widgets that are built but not on the screen have nothing to update.
+    // Registering applies the then current state, so none is missed meanwhile.
+    if (!atomic_get(&listener->registered)) {
+        return;
+    }
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LATENCY_PROBE)
+    // The oldest event whose state is not applied yet keeps its stamp
+    if (entered != 0) {
+        atomic_cas(&listener->latency.entered, 0, entered);
+    }
+#endif
+    atomic_inc(&listener->published);
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_COALESCE_UPDATES)
+    atomic_set(&listener->pending, 1);
+#else
+    // The work clears pending before it reads the state, so only the first
+    // event after that submits it again
+    if (!atomic_set(&listener->pending, 1)) {
+        k_work_submit_to_queue(zmk_display_work_q(), &listener->work);
+    }
+#endif
+}
+
+// Stores a state for the display thread. Stores are serialized by lock, which
+// the display thread takes as well to read the state.
+static inline void zmk_dongle_display_listener_write_locked(struct k_spinlock *lock, void *states,
+                                                            const void *value, size_t size) {
+    k_spinlock_key_t key = k_spin_lock(lock);
+    memcpy(states, value, size);
+    k_spin_unlock(lock, key);
+}
+
+static inline void zmk_dongle_display_listener_read_locked(struct k_spinlock *lock, void *copy,
+                                                           const void *states, size_t size) {
+    k_spinlock_key_t key = k_spin_lock(lock);
+    memcpy(copy, states, size);
+    k_spin_unlock(lock, key);
+}
+
+// Stores a state without locks into a slot nobody else uses, then publishes
+// it as the newest. Neither side ever waits for the other. Claiming a slot
+// only fails while two other events are storing into the same listener at
+// once, and then only until one of them is done.
+static inline void
+zmk_dongle_display_listener_write_lockfree(struct zmk_dongle_display_listener *listener,
+                                           void *states, const void *value, size_t size) {
+    int slot = 0;
+    while (!atomic_cas(&listener->refs[slot], 0, 1)) {
+        if (++slot == ZMK_DONGLE_DISPLAY_LISTENER_SLOTS) {
+            slot = 0;
+            k_yield();
+        }
+    }
+    memcpy((uint8_t *)states + slot * size, value, size);
+
+    // The reference taken by the claim passes from the store to the publication
+    atomic_val_t replaced = atomic_set(&listener->latest, slot + 1);
+    if (replaced != 0) {
+        atomic_dec(&listener->refs[replaced - 1]);
+    }
+}
+
+// Copies the newest state out, reading again if a store replaced it and its
+// slot may have been claimed by another store before the read held it
+static inline void
+zmk_dongle_display_listener_read_lockfree(struct zmk_dongle_display_listener *listener,
+                                          void *copy, const void *states, size_t size) {
+    for (;;) {
+        atomic_val_t latest = atomic_get(&listener->latest);
+        if (latest == 0) {
+            memset(copy, 0, size);
+            return;
+        }
+
+        atomic_inc(&listener->refs[latest - 1]);
+        bool newest = atomic_get(&listener->latest) == latest;
+        if (newest) {
+            memcpy(copy, (const uint8_t *)states + (latest - 1) * size, size);
+        }
+        atomic_dec(&listener->refs[latest - 1]);
+
+        if (newest) {
+            return;
+        }
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+        atomic_inc(&listener->retries);
+#endif
+    }
+}
+
+// Event side: stores a state for the display thread, without locks with
+// CONFIG_ZMK_DONGLE_DISPLAY_LOCKFREE_UPDATES
+static inline void zmk_dongle_display_listener_store(struct zmk_dongle_display_listener *listener,
+                                                     struct k_spinlock *lock, void *states,
+                                                     const void *value, size_t size,
+                                                     uint32_t entered) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    uint32_t start = zmk_dongle_display_probe_cycles();
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LOCKFREE_UPDATES)
+    ARG_UNUSED(lock);
+    zmk_dongle_display_listener_write_lockfree(listener, states, value, size);
+#else
+    zmk_dongle_display_listener_write_locked(lock, states, value, size);
+#endif
+    zmk_dongle_display_listener_mark(listener, entered);
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    atomic_add(&listener->store_cycles, zmk_dongle_display_probe_cycles() - start);
+    atomic_inc(&listener->stores);
+#endif
+}
+
+// Display side: copies the latest stored state
+static inline void zmk_dongle_display_listener_load(struct zmk_dongle_display_listener *listener,
+                                                    struct k_spinlock *lock, void *copy,
+                                                    const void *states, size_t size) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_LOCKFREE_UPDATES)
+    ARG_UNUSED(lock);
+    zmk_dongle_display_listener_read_lockfree(listener, copy, states, size);
+#else
+    zmk_dongle_display_listener_read_locked(lock, copy, states, size);
+#endif
+}
+
+// Drop-in replacement for ZMK_DISPLAY_WIDGET_LISTENER. With
+// CONFIG_ZMK_DONGLE_DISPLAY_COALESCE_UPDATES, events only store the latest
+// state and the widget gets one apply call per display frame, no matter how
+// many events arrived in between.
+#define DONGLE_DISPLAY_WIDGET_LISTENER(listener, state_type, cb, state_func)                       \
+    DONGLE_DISPLAY_WIDGET_LISTENER_FULL(listener, state_type, cb, state_func, NULL, NULL)
+
+// Like DONGLE_DISPLAY_WIDGET_LISTENER, but bool filter(const state_type *)
+// runs on the event side and states it rejects never reach the display thread.
+// It only runs once the widget is registered, and never on the state stored then.
+#define DONGLE_DISPLAY_WIDGET_LISTENER_FILTERED(listener, state_type, cb, state_func, filter)      \
+    DONGLE_DISPLAY_WIDGET_LISTENER_FULL(listener, state_type, cb, state_func, filter, NULL)
+
+// Like DONGLE_DISPLAY_WIDGET_LISTENER, but the display thread keeps the state
+// it applied last and skips cb when bool eq(const state_type *, const state_type *)
+// finds nothing the widget shows has changed.
+#define DONGLE_DISPLAY_WIDGET_LISTENER_DIFFED(listener, state_type, cb, state_func, eq)            \
+    DONGLE_DISPLAY_WIDGET_LISTENER_FULL(listener, state_type, cb, state_func, NULL, eq)
+
+#define DONGLE_DISPLAY_WIDGET_LISTENER_FULL(listener, state_type, cb, state_func, filter, eq)      \
+    static struct k_spinlock listener##_lock;                                                      \
+    static state_type __##listener##_state[ZMK_DONGLE_DISPLAY_LISTENER_STATES];                    \
+    static state_type listener##_applied_state;                                                    \
+    static bool listener##_has_applied;                                                            \
+    static struct zmk_dongle_display_listener listener##_listener;                                 \
+    static bool listener##_apply(void) {                                                           \
+        bool (*eq_func)(const state_type *, const state_type *) = eq;                              \
+        state_type copy;                                                                           \
+        zmk_dongle_display_listener_load(&listener##_listener, &listener##_lock, &copy,            \
+                                         __##listener##_state, sizeof(copy));                      \
+        if (eq_func != NULL) {                                                                     \
+            if (listener##_has_applied && eq_func(&copy, &listener##_applied_state)) {             \
+                return false;                                                                      \
+            }                                                                                      \
+            listener##_applied_state = copy;                                                       \
+            listener##_has_applied = true;                                                         \
+        }                                                                                          \
+        cb(copy);                                                                                  \
+        return true;                                                                               \
+    }                                                                                              \
+    static struct zmk_dongle_display_listener listener##_listener = {                              \
+        .name = #listener,                                                                         \
+        .apply = listener##_apply,                                                                 \
+    };                                                                                             \
+    static void listener##_store(state_type state, uint32_t entered) {                             \
+        zmk_dongle_display_listener_store(&listener##_listener, &listener##_lock,                  \
+                                          __##listener##_state, &state, sizeof(state), entered);   \
+    }                                                                                              \
+    /* Filters may remember what they let through, so they only see states */                      \
+    /* that are stored */                                                                          \
+    static void listener##_publish(state_type state, uint32_t entered) {                           \
+        bool (*filter_func)(const state_type *) = filter;                                          \
+        if (!atomic_get(&listener##_listener.registered)) {                                        \
+            return;                                                                                \
+        }                                                                                          \
+        if (filter_func != NULL && !filter_func(&state)) {                                         \
+            atomic_inc(&listener##_listener.filtered);                                             \
+            return;                                                                                \
+        }                                                                                          \
+        listener##_store(state, entered);                                                          \
+    }                                                                                              \
+    /* The current state is stored unfiltered, the widget shows nothing yet */                     \
+    static int listener##_init(void) {                                                             \
+        zmk_dongle_display_listener_register(&listener##_listener);                                \
+        listener##_store(state_func(NULL), 0);                                                     \
+        return 0;                                                                                  \
+    }                                                                                              \
+    static inline void listener##_watch(lv_obj_t *obj) {                                           \
+        zmk_dongle_display_listener_watch(&listener##_listener, obj);                              \
+    }                                                                                              \
+    static int listener##_cb(const zmk_event_t *eh) {                                              \
+        uint32_t entered = zmk_dongle_display_listener_now();                                      \
+        if (zmk_display_is_initialized()) {                                                        \
+            listener##_publish(state_func(eh), entered);                                           \
+        }                                                                                          \
+        return ZMK_EV_EVENT_BUBBLE;                                                                \
+    }                                                                                              \
+    ZMK_LISTENER(listener, listener##_cb);
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/event_manager.h>
+#include <zmk/events/keycode_state_changed.h>
+#include <zmk/keys.h>
+
+#include "wpm_estimator.h"
+
+ZMK_EVENT_IMPL(zmk_dongle_display_wpm_changed);
+
+#define WINDOW_KEYS CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR_WINDOW_KEYS
+#define WINDOW_MS CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR_WINDOW_MS
+#define TICK_MS CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR_TICK_MS
+
+// A word is five keystrokes, as ZMK's own WPM counts it
+#define CHARS_PER_WORD 5
+
+// No press for this long ends the typing, which puts the floor at 12 WPM
+#define STOP_MS 1000
+
+// Every tick moves the average a quarter of the way to the instantaneous WPM
+#define SMOOTHING_SHIFT 2
+
+// Press times of the keys in the window, oldest first from start
+struct wpm_window {
+    uint32_t presses[WINDOW_KEYS];
+    uint16_t start;
+    uint16_t count;
+    uint16_t instant;
+    int32_t smoothed; // WPM in Q8
+};
+
+static uint16_t window_smoothed(const struct wpm_window *window) {
+    return (window->smoothed + (1 << 7)) >> 8;
+}
+
+// Every press is dropped once, so this stays O(1) per press and tick on average
+static void window_update(struct wpm_window *window, uint32_t now) {
+    if (window->count > 0 &&
+        now - window->presses[(window->start + window->count - 1) % WINDOW_KEYS] > STOP_MS) {
+        window->count = 0;
+    }
+    while (window->count > 0 && now - window->presses[window->start] > WINDOW_MS) {
+        window->start = (window->start + 1) % WINDOW_KEYS;
+        window->count--;
+    }
+
+    if (window->count < 2) {
+        window->instant = 0;
+        return;
+    }
+
+    // The intervals between the presses in the window, stretched by the time
+    // since the last one, so a pause pulls the rate down before it ends the typing
+    uint32_t span = MAX(now - window->presses[window->start], 1);
+    window->instant =
+        MIN((uint64_t)(window->count - 1) * 60 * MSEC_PER_SEC / (CHARS_PER_WORD * span),
+            UINT16_MAX);
+}
+
+static void window_press(struct wpm_window *window, uint32_t now) {
+    // A full ring drops its oldest press, which only shortens the window
+    if (window->count == WINDOW_KEYS) {
+        window->start = (window->start + 1) % WINDOW_KEYS;
+        window->count--;
+    }
+    window->presses[(window->start + window->count) % WINDOW_KEYS] = now;
+    window->count++;
+    window_update(window, now);
+}
+
+static void window_smooth(struct wpm_window *window) {
+    window->smoothed +=
+        ((int32_t)window->instant * 256 - window->smoothed) / (1 << SMOOTHING_SHIFT);
+
+    // The division leaves a remainder below one WPM that would never decay
+    if (window->count == 0 && window_smoothed(window) == 0) {
+        window->smoothed = 0;
+    }
+}
+
+static struct wpm_window window;
+static struct zmk_dongle_display_wpm_changed raised;
+static struct k_spinlock lock;
+
+static void wpm_raise_if_changed(void) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    struct zmk_dongle_display_wpm_changed current = {
+        .instant = window.instant,
+        .smoothed = window_smoothed(&window),
+    };
+    bool changed = current.instant != raised.instant || current.smoothed != raised.smoothed;
+    raised = current;
+    k_spin_unlock(&lock, key);
+
+    if (changed) {
+        raise_zmk_dongle_display_wpm_changed(current);
+    }
+}
+
+static void wpm_tick_work_cb(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(wpm_tick_work, wpm_tick_work_cb);
+
+// Ticks only run until the window is empty and the average is back at 0
+static void wpm_tick_work_cb(struct k_work *work) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    window_update(&window, k_uptime_get_32());
+    window_smooth(&window);
+    bool active = window.count > 0 || window.smoothed != 0;
+    k_spin_unlock(&lock, key);
+
+    wpm_raise_if_changed();
+    if (active) {
+        k_work_schedule(&wpm_tick_work, K_MSEC(TICK_MS));
+    }
+}
+
+uint16_t zmk_dongle_display_wpm_instant(void) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint16_t instant = window.instant;
+    k_spin_unlock(&lock, key);
+    return instant;
+}
+
+uint16_t zmk_dongle_display_wpm_smoothed(void) {
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint16_t smoothed = window_smoothed(&window);
+    k_spin_unlock(&lock, key);
+    return smoothed;
+}
+
+static int wpm_estimator_listener(const zmk_event_t *eh) {
+    const struct zmk_keycode_state_changed *ev = as_zmk_keycode_state_changed(eh);
+
+    // Presses count at once, where ZMK's own WPM waits for the release
+    if (ev == NULL || !ev->state || is_mod(ev->usage_page, ev->keycode)) {
+        return ZMK_EV_EVENT_BUBBLE;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    window_press(&window, k_uptime_get_32());
+    k_spin_unlock(&lock, key);
+
+    wpm_raise_if_changed();
+    // Leaves a scheduled tick where it is, so fast typing does not hold it off
+    k_work_schedule(&wpm_tick_work, K_MSEC(TICK_MS));
+    return ZMK_EV_EVENT_BUBBLE;
+}
+
+ZMK_LISTENER(dongle_display_wpm_estimator, wpm_estimator_listener);
+ZMK_SUBSCRIPTION(dongle_display_wpm_estimator, zmk_keycode_state_changed);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+// Typing at alternating intervals for typing_ms, followed by a pause
+struct wpm_trace {
+    const char *name;
+    uint16_t intervals_ms[2];
+    uint32_t typing_ms;
+};
+
+static const struct wpm_trace traces[] = {
+    {"steady 60", {200, 200}, 17600},
+    {"burst 120", {100, 100}, 6500},
+    {"uneven 80", {100, 200}, 12300},
+};
+
+#define REPLAY_PAUSE_MS 10000
+
+// ZMK's own WPM counts releases, evaluates them once a second and starts
+// counting over every 5 seconds
+#define STOCK_UPDATE_MS 1000
+#define STOCK_RESET_UPDATES 5
+
+struct stock_wpm {
+    uint32_t releases;
+    uint8_t updates;
+    uint16_t wpm;
+};
+
+static void stock_update(struct stock_wpm *stock) {
+    stock->updates++;
+    stock->wpm = stock->releases * 60 * MSEC_PER_SEC /
+                 (CHARS_PER_WORD * stock->updates * STOCK_UPDATE_MS);
+    if (stock->updates >= STOCK_RESET_UPDATES) {
+        stock->updates = 0;
+        stock->releases = 0;
+    }
+}
+
+enum replay_estimate {
+    replay_instant,
+    replay_smoothed,
+    replay_stock,
+    REPLAY_ESTIMATES,
+};
+
+static const char *const replay_names[REPLAY_ESTIMATES] = {"instant", "smoothed", "zmk"};
+
+struct replay_result {
+    int32_t rise_ms; // until 90% of the typed WPM is shown, -1 if never
+    int32_t fall_ms; // after the typing stopped, until 10% of it is shown, -1 if never
+    uint32_t error;  // summed over the second half of the typing
+};
+
+// Steps through every trace one millisecond at a time
+void zmk_dongle_display_wpm_replay(void) {
+    for (size_t t = 0; t < ARRAY_SIZE(traces); t++) {
+        const struct wpm_trace *trace = &traces[t];
+        uint32_t actual = 2 * 60 * MSEC_PER_SEC /
+                          (CHARS_PER_WORD * (trace->intervals_ms[0] + trace->intervals_ms[1]));
+        struct wpm_window replay = {0};
+        struct stock_wpm stock = {0};
+        struct replay_result results[REPLAY_ESTIMATES];
+        uint32_t next_press = 0, presses = 0, error_samples = 0;
+
+        for (int i = 0; i < REPLAY_ESTIMATES; i++) {
+            results[i] = (struct replay_result){.rise_ms = -1, .fall_ms = -1};
+        }
+
+        for (uint32_t now = 0; now < trace->typing_ms + REPLAY_PAUSE_MS; now++) {
+            if (now == next_press && now < trace->typing_ms) {
+                window_press(&replay, now);
+                stock.releases++;
+                next_press += trace->intervals_ms[presses++ % 2];
+            }
+            if (now % TICK_MS == 0) {
+                window_update(&replay, now);
+                window_smooth(&replay);
+            }
+            if (now > 0 && now % STOCK_UPDATE_MS == 0) {
+                stock_update(&stock);
+            }
+
+            uint16_t shown[REPLAY_ESTIMATES] = {
+                [replay_instant] = replay.instant,
+                [replay_smoothed] = window_smoothed(&replay),
+                [replay_stock] = stock.wpm,
+            };
+            bool steady = now >= trace->typing_ms / 2 && now < trace->typing_ms;
+            error_samples += steady;
+
+            for (int i = 0; i < REPLAY_ESTIMATES; i++) {
+                struct replay_result *result = &results[i];
+
+                if (result->rise_ms < 0 && shown[i] * 10 >= actual * 9) {
+                    result->rise_ms = now;
+                }
+                if (result->fall_ms < 0 && now >= trace->typing_ms && shown[i] * 10 <= actual) {
+                    result->fall_ms = now - trace->typing_ms;
+                }
+                if (steady) {
+                    result->error += abs((int)shown[i] - (int)actual);
+                }
+            }
+        }
+
+        for (int i = 0; i < REPLAY_ESTIMATES; i++) {
+            LOG_INF("bench wpm %-10s %-8s %3u wpm typed, shown after %5d ms, gone %5d ms after "
+                    "the typing, %u wpm off on average",
+                    trace->name, replay_names[i], actual, results[i].rise_ms, results[i].fall_ms,
+                    results[i].error / MAX(error_samples, 1));
+        }
+    }
+}
+#endif
@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <zephyr/kernel.h>
+#include <zmk/event_manager.h>
+
+// Raised when either estimate changes by a whole WPM
+struct zmk_dongle_display_wpm_changed {
+    uint16_t instant;
+    uint16_t smoothed;
+};
+
+ZMK_EVENT_DECLARE(zmk_dongle_display_wpm_changed);
+
+// WPM over the key presses in the sliding window, as of the last press or tick
+uint16_t zmk_dongle_display_wpm_instant(void);
+
+// The instantaneous WPM through an exponential moving average, steadier to read
+uint16_t zmk_dongle_display_wpm_smoothed(void);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+// Replays typing traces through the estimator and a model of ZMK's own WPM,
+// and logs how fast and how closely each follows the typing
+void zmk_dongle_display_wpm_replay(void);
+#endif
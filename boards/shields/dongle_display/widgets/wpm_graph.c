@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
+
+#include <zmk/wpm.h>
+
+#include "wpm_graph.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+#include "../refresh_probe.h"
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR)
+#include "wpm_estimator.h"
+#endif
+
+#define GRAPH_WIDTH CONFIG_ZMK_DONGLE_DISPLAY_WPM_GRAPH_WIDTH
+#define GRAPH_HEIGHT CONFIG_ZMK_DONGLE_DISPLAY_WPM_GRAPH_HEIGHT
+#define GRAPH_STRIDE DIV_ROUND_UP(GRAPH_WIDTH, 8)
+
+// One column per sample, so the graph spans the configured minutes
+#define SAMPLE_MS (CONFIG_ZMK_DONGLE_DISPLAY_WPM_GRAPH_MINUTES * 60 * MSEC_PER_SEC / GRAPH_WIDTH)
+
+// The top of the graph moves in steps, so the scale rarely changes
+#define SCALE_STEP 20
+
+static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
+
+// One sample per column, the oldest at next, which is also where the newest goes
+static uint8_t samples[GRAPH_WIDTH];
+static uint16_t next;
+static uint16_t scale = SCALE_STEP;
+
+// Rows padded to whole bytes with the leftmost pixel in the top bit, drawn in
+// the image recolor like the layer names
+static uint8_t graph_data[GRAPH_STRIDE * GRAPH_HEIGHT];
+static const lv_img_dsc_t graph_img = {
+    .header.cf = LV_IMG_CF_ALPHA_1BIT,
+    .header.w = GRAPH_WIDTH,
+    .header.h = GRAPH_HEIGHT,
+    .data_size = sizeof(graph_data),
+    .data = graph_data,
+};
+
+static lv_timer_t *sample_timer;
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+static atomic_t rendered_samples;
+static atomic_t render_cycles;
+static atomic_t rescales;
+
+void zmk_widget_wpm_graph_take_render_stats(uint32_t *count, uint32_t *ns, uint32_t *rescaled) {
+    *count = atomic_clear(&rendered_samples);
+    *ns = zmk_dongle_display_probe_cycles_to_ns((uint32_t)atomic_clear(&render_cycles));
+    *rescaled = atomic_clear(&rescales);
+}
+#endif
+
+static void wpm_graph_draw_column(uint16_t x, uint8_t wpm) {
+    uint8_t height = MIN(DIV_ROUND_UP(wpm * GRAPH_HEIGHT, scale), GRAPH_HEIGHT);
+    uint8_t mask = 0x80 >> (x % 8);
+
+    for (uint8_t y = 0; y < GRAPH_HEIGHT; y++) {
+        uint8_t *byte = &graph_data[y * GRAPH_STRIDE + x / 8];
+
+        if (y >= GRAPH_HEIGHT - height) {
+            *byte |= mask;
+        } else {
+            *byte &= ~mask;
+        }
+    }
+}
+
+// Moves every pixel one column to the left. The padding bits past the last
+// column stay clear, so the last column is left empty for the newest sample.
+static void wpm_graph_shift(void) {
+    for (uint8_t y = 0; y < GRAPH_HEIGHT; y++) {
+        uint8_t *row = &graph_data[y * GRAPH_STRIDE];
+
+        for (uint8_t i = 0; i < GRAPH_STRIDE - 1; i++) {
+            row[i] = (row[i] << 1) | (row[i + 1] >> 7);
+        }
+        row[GRAPH_STRIDE - 1] <<= 1;
+    }
+}
+
+static void wpm_graph_redraw(void) {
+    memset(graph_data, 0, sizeof(graph_data));
+    for (uint16_t x = 0; x < GRAPH_WIDTH; x++) {
+        wpm_graph_draw_column(x, samples[(next + x) % GRAPH_WIDTH]);
+    }
+}
+
+static void wpm_graph_sample_cb(lv_timer_t *timer) {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    uint32_t start = zmk_dongle_display_probe_cycles();
+#endif
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR)
+    uint8_t wpm = MIN(zmk_dongle_display_wpm_smoothed(), UINT8_MAX);
+#else
+    uint8_t wpm = MIN(zmk_wpm_get_state(), UINT8_MAX);
+#endif
+    uint8_t dropped = samples[next];
+
+    samples[next] = wpm;
+    next = (next + 1) % GRAPH_WIDTH;
+
+    uint8_t max = 0;
+    for (uint16_t i = 0; i < GRAPH_WIDTH; i++) {
+        max = MAX(max, samples[i]);
+    }
+
+    // A graph of nothing but zeros stays the same, and the panel is left alone
+    if (max == 0 && dropped == 0) {
+        return;
+    }
+
+    uint16_t new_scale = MAX(ROUND_UP(max, SCALE_STEP), SCALE_STEP);
+    if (new_scale != scale) {
+        scale = new_scale;
+        wpm_graph_redraw();
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+        atomic_inc(&rescales);
+#endif
+    } else {
+        wpm_graph_shift();
+        wpm_graph_draw_column(GRAPH_WIDTH - 1, wpm);
+    }
+
+    struct zmk_widget_wpm_graph *widget;
+    SYS_SLIST_FOR_EACH_CONTAINER(&widgets, widget, node) { lv_obj_invalidate(widget->obj); }
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+    atomic_inc(&rendered_samples);
+    atomic_add(&render_cycles, zmk_dongle_display_probe_cycles() - start);
+#endif
+}
+
+int zmk_widget_wpm_graph_init(struct zmk_widget_wpm_graph *widget, lv_obj_t *parent) {
+    widget->obj = lv_img_create(parent);
+    lv_img_set_src(widget->obj, &graph_img);
+    lv_obj_set_style_img_recolor(widget->obj, lv_obj_get_style_text_color(parent, LV_PART_MAIN),
+                                 0);
+
+    // Widgets share the samples and the image, the first one starts sampling
+    if (sample_timer == NULL) {
+        sample_timer = lv_timer_create(wpm_graph_sample_cb, SAMPLE_MS, NULL);
+    }
+
+    sys_slist_append(&widgets, &widget->node);
+    return 0;
+}
+
+lv_obj_t *zmk_widget_wpm_graph_obj(struct zmk_widget_wpm_graph *widget) { return widget->obj; }
@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2024 The ZMK Contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lvgl.h>
+#include <zephyr/kernel.h>
+
+struct zmk_widget_wpm_graph {
+    sys_snode_t node;
+    lv_obj_t *obj;
+};
+
+int zmk_widget_wpm_graph_init(struct zmk_widget_wpm_graph *widget, lv_obj_t *parent);
+lv_obj_t *zmk_widget_wpm_graph_obj(struct zmk_widget_wpm_graph *widget);
+
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_BENCHMARK)
+// Samples added to the graph since the last call, the nanoseconds it took to
+// render them and how many of them changed the scale and redrew the whole graph
+void zmk_widget_wpm_graph_take_render_stats(uint32_t *count, uint32_t *ns, uint32_t *rescaled);
+#endif
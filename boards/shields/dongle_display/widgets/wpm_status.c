@@ -5,55 +5,104 @@ LOG_MODULE_DECLARE(zmk, CONFIG_ZMK_LOG_LEVEL);
 
 #include <zmk/display.h>
 #include <zmk/event_manager.h>
+#include <zmk/events/layer_state_changed.h>
 #include <zmk/events/wpm_state_changed.h>
-#include <zmk/display/widgets/layer_status.h>
-#include <zmk/endpoints.h>
 #include <zmk/keymap.h>
+#include <zmk/wpm.h>
 
 #include "wpm_status.h"
+#include "widget_listener.h"
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR)
+#include "wpm_estimator.h"
+#endif
 
 LV_IMG_DECLARE(sym_speedometer);
 
+#ifndef ZMK_KEYMAP_LAYERS_LEN
+#define LAYER_CHILD_LEN(node) 1 +
+#define ZMK_KEYMAP_LAYERS_LEN (DT_FOREACH_CHILD(DT_INST(0, zmk_keymap), LAYER_CHILD_LEN) 0)
+#endif
+
 static sys_slist_t widgets = SYS_SLIST_STATIC_INIT(&widgets);
 static int last_wpm = -1;
-static int64_t last_wpm_update_time = 0;
-#define WPM_UPDATE_INTERVAL_MS 250  // Throttle: max 4 updates per second
+static bool last_disabled;
+
+// Layers listed in CONFIG_ZMK_DONGLE_DISPLAY_WPM_DISABLED_LAYERS, resolved once at init
+static uint32_t disabled_layers;
+// Whether the highest active layer is one of them, kept up to date by layer events
+static atomic_t wpm_disabled;
 
 struct wpm_status_state
 {
     int wpm;
-    const char *layer;
+    bool disabled;
 };
 
+static void resolve_disabled_layers(void)
+{
+    const char *list = CONFIG_ZMK_DONGLE_DISPLAY_WPM_DISABLED_LAYERS;
+
+    while (*list != '\0') {
+        while (*list == ',' || *list == ' ') {
+            list++;
+        }
+
+        size_t len = strcspn(list, ",");
+        while (len > 0 && list[len - 1] == ' ') {
+            len--;
+        }
+
+        for (uint8_t i = 0; i < MIN(ZMK_KEYMAP_LAYERS_LEN, 32); i++) {
+            const char *name = zmk_keymap_layer_name(i);
+
+            if (name != NULL && len > 0 && strlen(name) == len && strncmp(name, list, len) == 0) {
+                disabled_layers |= BIT(i);
+            }
+        }
+
+        list += strcspn(list, ",");
+    }
+}
+
 static struct wpm_status_state get_state(const zmk_event_t *_eh)
 {
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR)
+    const struct zmk_dongle_display_wpm_changed *ev = as_zmk_dongle_display_wpm_changed(_eh);
+#else
     const struct zmk_wpm_state_changed *ev = as_zmk_wpm_state_changed(_eh);
-    uint8_t index = zmk_keymap_highest_layer_active();
+#endif
+
+    if (ev == NULL) {
+        // Layer change or initial state
+        atomic_set(&wpm_disabled,
+                   (disabled_layers & BIT(zmk_keymap_highest_layer_active())) != 0);
+    }
 
     return (struct wpm_status_state){
-        .wpm = ev ? ev->state : 0,
-        .layer = zmk_keymap_layer_name(index)
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR)
+        .wpm = ev ? ev->smoothed : zmk_dongle_display_wpm_smoothed(),
+#else
+        .wpm = ev ? ev->state : zmk_wpm_get_state(),
+#endif
+        .disabled = atomic_get(&wpm_disabled),
     };
 }
 
 static void set_wpm(struct zmk_widget_wpm_status *widget, struct wpm_status_state state)
 {
-    // Early exit if WPM unchanged
-    if (state.wpm == last_wpm) {
-        return;
-    }
+    bool layer_changed = state.disabled != last_disabled;
 
-    // Throttle updates to prevent display thread flooding
-    int64_t now = k_uptime_get();
-    if ((now - last_wpm_update_time) < WPM_UPDATE_INTERVAL_MS) {
+    // Early exit if nothing changed
+    if (state.wpm == last_wpm && !layer_changed) {
         return;
     }
-    last_wpm_update_time = now;
+
+    // Not throttled here, as a dropped update could be the last one, like the
+    // final drop to 0. Updates arriving within one frame are merged by the listener.
     last_wpm = state.wpm;
+    last_disabled = state.disabled;
 
-    // NULL check for layer name before strstr to prevent crash
-    if (state.layer != NULL &&
-        strstr(CONFIG_ZMK_DONGLE_DISPLAY_WPM_DISABLED_LAYERS, state.layer) != NULL) {
+    if (state.disabled) {
         lv_label_set_text(widget->wpm_label, "-");
         return;
     }
@@ -72,9 +121,14 @@ static void wpm_status_update_cb(struct wpm_status_state state)
     }
 }
 
-ZMK_DISPLAY_WIDGET_LISTENER(widget_wpm_status, struct wpm_status_state,
-                            wpm_status_update_cb, get_state)
+DONGLE_DISPLAY_WIDGET_LISTENER(widget_wpm_status, struct wpm_status_state,
+                               wpm_status_update_cb, get_state)
+#if IS_ENABLED(CONFIG_ZMK_DONGLE_DISPLAY_WPM_ESTIMATOR)
+ZMK_SUBSCRIPTION(widget_wpm_status, zmk_dongle_display_wpm_changed);
+#else
 ZMK_SUBSCRIPTION(widget_wpm_status, zmk_wpm_state_changed);
+#endif
+ZMK_SUBSCRIPTION(widget_wpm_status, zmk_layer_state_changed);
 
 int zmk_widget_wpm_status_init(struct zmk_widget_wpm_status *widget, lv_obj_t *parent)
 {
@@ -90,6 +144,8 @@ int zmk_widget_wpm_status_init(struct zmk_widget_wpm_status *widget, lv_obj_t *p
 
     sys_slist_append(&widgets, &widget->node);
 
+    resolve_disabled_layers();
+    widget_wpm_status_watch(widget->obj);
     widget_wpm_status_init();
     return 0;
 }